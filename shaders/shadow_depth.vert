@@ -1,18 +1,28 @@
 #version 330 core
 
+#include "terrain_noise.glsl"
+
 layout(location = 0) in vec3 aPos;
 layout(location = 2) in vec3 aNorm;
 layout(location = 3) in vec4 jointIndices;
 layout(location = 4) in vec4 jointWeights;
+layout(location = 5) in float aPackedHeight;  // packed terrain vertices, see terrain.vert
 
 uniform mat4 Model;  // position/scale/rotation
 uniform mat4 nodeMatrix;  // per-node transform for mesh hierarchy
 uniform mat4 jointMatrices[100];  // bone transforms for animation
 uniform bool isSkinned;  // is this a skeletal model?
+uniform int terrainHeightSource;  // terrain only, 1: replace the height with the noise, 2: with the height map, 3: packed vertices (see terrain.vert)
+uniform float gridExtent;
+uniform float heightScale;
 
 void main()
 {
     vec4 worldPos = vec4(aPos, 1.0);
+    if (terrainHeightSource == 3) {
+        vec2 uv = vec2(gl_VertexID % gridResolution, gl_VertexID / gridResolution) / float(gridResolution) - 0.5;
+        worldPos = vec4(gridExtent * uv.x, aPackedHeight * heightScale, gridExtent * uv.y, 1.0);
+    }
     
     if (isSkinned) {
         // Skinned model: apply bone transforms then node matrix
@@ -29,4 +39,10 @@ void main()
     
     // Apply the model transform (position/scale/rotation of the entity)
     gl_Position = Model * worldPos;
+
+    if (terrainHeightSource == 1) {
+        gl_Position.y = terrainHeight(gl_Position.xz);
+    } else if (terrainHeightSource == 2) {
+        gl_Position.y = heightMapAt(gl_VertexID % gridResolution, gl_VertexID / gridResolution);
+    }
 }
@@ -1,10 +1,27 @@
 #version 330 core
 
+#include "terrain_noise.glsl"
+
 layout (location = 0) in vec3 aPos;
 layout (location = 2) in vec3 aNorm;
+layout (location = 5) in float aPackedHeight;  // heightSource 3: snorm16 height / heightScale
+layout (location = 6) in vec2 aPackedNormal;   // heightSource 3: octahedral normal, snorm16
 
 uniform mat4 MVP;
 uniform mat4 Model;
+uniform int heightSource;       // 0: aPos.y/aNorm, 1: terrainHeight, 2: heightMapAt (terrain_noise.glsl), 3: packed vertices
+uniform float gridExtent;       // heightSource 3: local width of the grid, x/z come from gl_VertexID
+uniform float heightScale;      // heightSource 3: aPackedHeight is relative to this
+uniform float normalEpsilon;    // world-space step for the computed normals, one grid cell
+
+// Inverse of octahedralEncode in TerrainVertex.hpp (folded around y)
+vec3 octahedralDecode(vec2 e) {
+    vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+    float t = max(-n.y, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.z += n.z >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
 out vec4 color;
 out vec3 fragPos;
@@ -13,10 +30,43 @@ out vec3 worldPosition;
 
 void main()
 {
-    gl_Position = MVP * vec4(aPos, 1.0);
+    vec3 pos = aPos;
+    int gridX = gl_VertexID % max(gridResolution, 1);
+    int gridZ = gl_VertexID / max(gridResolution, 1);
+    if (heightSource == 1) {
+        // Static grid: only x/z are meaningful, the model matrix has no y scale or translation
+        vec2 worldXZ = (Model * vec4(aPos.x, 0.0, aPos.z, 1.0)).xz;
+        pos.y = terrainHeight(worldXZ);
+    } else if (heightSource == 2) {
+        pos.y = heightMapAt(gridX, gridZ);
+    } else if (heightSource == 3) {
+        vec2 uv = vec2(gridX, gridZ) / float(gridResolution) - 0.5;
+        pos = vec3(gridExtent * uv.x, aPackedHeight * heightScale, gridExtent * uv.y);
+    }
+    gl_Position = MVP * vec4(pos, 1.0);
 
     color = vec4(1.0, 0.3, 1.0, 1.0);
-    fragPos = aPos;
-    worldPosition = vec3(Model * vec4(aPos, 1.0));
-    fragNorm = mat3(transpose(inverse(Model))) * aNorm; // [ACKN] ChatGPT suggested fix to this line for terrain lighting issues
+    fragPos = pos;
+    worldPosition = vec3(Model * vec4(pos, 1.0));
+    if (heightSource == 1) {
+        // Central differences, already in world space
+        float e = normalEpsilon;
+        float hL = terrainHeight(worldPosition.xz - vec2(e, 0.0));
+        float hR = terrainHeight(worldPosition.xz + vec2(e, 0.0));
+        float hD = terrainHeight(worldPosition.xz - vec2(0.0, e));
+        float hU = terrainHeight(worldPosition.xz + vec2(0.0, e));
+        fragNorm = normalize(vec3(hL - hR, 2.0 * e, hD - hU));
+    } else if (heightSource == 2) {
+        // Central differences over neighbouring texels, one cell apart in world space
+        float e = normalEpsilon;
+        float hL = heightMapAt(gridX - 1, gridZ);
+        float hR = heightMapAt(gridX + 1, gridZ);
+        float hD = heightMapAt(gridX, gridZ - 1);
+        float hU = heightMapAt(gridX, gridZ + 1);
+        fragNorm = normalize(vec3(hL - hR, 2.0 * e, hD - hU));
+    } else if (heightSource == 3) {
+        fragNorm = mat3(transpose(inverse(Model))) * octahedralDecode(aPackedNormal);
+    } else {
+        fragNorm = mat3(transpose(inverse(Model))) * aNorm; // [ACKN] ChatGPT suggested fix to this line for terrain lighting issues
+    }
 }
\ No newline at end of file
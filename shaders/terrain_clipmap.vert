@@ -0,0 +1,33 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec3 aNorm;
+layout (location = 3) in float aMorphHeight; // height of the next coarser clipmap level at this vertex
+
+uniform mat4 MVP;
+uniform mat4 Model;
+uniform vec3 cameraPos;
+uniform float morphStart; // distance from the camera where this level starts blending into the coarser one
+uniform float morphEnd;   // distance where it fully matches the coarser one
+
+out vec4 color;
+out vec3 fragPos;
+out vec3 fragNorm;
+out vec3 worldPosition;
+
+void main()
+{
+    // Geomorph: near the outer edge of the level, slide vertices onto the coarser level's surface
+    // so both levels agree where they meet
+    vec3 levelWorldPos = vec3(Model * vec4(aPos, 1.0));
+    vec2 d = abs(levelWorldPos.xz - cameraPos.xz);
+    float morph = clamp((max(d.x, d.y) - morphStart) / (morphEnd - morphStart), 0.0, 1.0);
+
+    vec3 pos = vec3(aPos.x, mix(aPos.y, aMorphHeight, morph), aPos.z);
+    gl_Position = MVP * vec4(pos, 1.0);
+
+    color = vec4(1.0, 0.3, 1.0, 1.0);
+    fragPos = pos;
+    worldPosition = vec3(Model * vec4(pos, 1.0));
+    fragNorm = mat3(transpose(inverse(Model))) * aNorm;
+}
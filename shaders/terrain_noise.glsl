@@ -0,0 +1,122 @@
+// Terrain height functions shared by terrain.vert and shadow_depth.vert.
+// Not a shader on its own: LoadShadersFromFile pastes it over their #include line, right after #version.
+
+// ---- GPU terrain noise, must match PerlinNoise::octavePerlin and terrainHeightAt on the CPU ----
+uniform usampler2D permTexture;  // PerlinNoise's (seeded) permutation table, 256x1 R8UI
+uniform int noiseBasis;          // NoiseBasis: 0 Perlin, 1 Simplex, 2 Value
+uniform int octaves;
+uniform float persistence;
+uniform float lacunarity;
+uniform float peakHeight;
+uniform float horizontalScale;   // world units per unit of noise space
+
+int perm(int i) {
+    return int(texelFetch(permTexture, ivec2(i & 255, 0), 0).r);
+}
+
+float grad2D(int hash, float x, float y) {
+    return ((hash & 1) == 0 ? x : -x) + ((hash & 2) == 0 ? y : -y);
+}
+
+float fade(float t) {
+    return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
+}
+
+float perlin2D(vec2 p) {
+    int xi = int(floor(p.x)) & 255;
+    int yi = int(floor(p.y)) & 255;
+    float xf = fract(p.x);
+    float yf = fract(p.y);
+    float u = fade(xf);
+    float v = fade(yf);
+
+    int aa = perm(perm(xi) + yi);
+    int ab = perm(perm(xi) + yi + 1);
+    int ba = perm(perm(xi + 1) + yi);
+    int bb = perm(perm(xi + 1) + yi + 1);
+
+    float x1 = mix(grad2D(aa, xf, yf), grad2D(ba, xf - 1.0, yf), u);
+    float x2 = mix(grad2D(ab, xf, yf - 1.0), grad2D(bb, xf - 1.0, yf - 1.0), u);
+    return (mix(x1, x2, v) + 1.0) / 2.0;
+}
+
+vec2 simplexGradient(int hash) {
+    float s = (hash & 1) == 0 ? 1.0 : -1.0;
+    hash &= 6;
+    if (hash == 0) return vec2(s, 1.0);
+    if (hash == 2) return vec2(s, -1.0);
+    if (hash == 4) return vec2(s, 0.0);
+    return vec2(0.0, s);
+}
+
+float simplexCorner(vec2 d, int hash) {
+    float t = max(0.5 - dot(d, d), 0.0);
+    t *= t;
+    return t * t * dot(simplexGradient(hash), d);
+}
+
+float simplex2D(vec2 p) {
+    const float F2 = 0.36602540378;
+    const float G2 = 0.21132486540;
+    vec2 cell = floor(p + (p.x + p.y) * F2);
+    vec2 d0 = p - cell + (cell.x + cell.y) * G2;
+    ivec2 o1 = d0.x > d0.y ? ivec2(1, 0) : ivec2(0, 1);
+    vec2 d1 = d0 - vec2(o1) + G2;
+    vec2 d2 = d0 - 1.0 + 2.0 * G2;
+
+    int ii = int(cell.x) & 255;
+    int jj = int(cell.y) & 255;
+    float n = simplexCorner(d0, perm(ii + perm(jj)))
+            + simplexCorner(d1, perm(ii + o1.x + perm(jj + o1.y)))
+            + simplexCorner(d2, perm(ii + 1 + perm(jj + 1)));
+    return (70.0 * n + 1.0) / 2.0;
+}
+
+float value2D(vec2 p) {
+    int xi = int(floor(p.x)) & 255;
+    int yi = int(floor(p.y)) & 255;
+    float u = fade(fract(p.x));
+    float v = fade(fract(p.y));
+
+    float aa = float(perm(perm(xi) + yi)) * (2.0 / 255.0) - 1.0;
+    float ab = float(perm(perm(xi) + yi + 1)) * (2.0 / 255.0) - 1.0;
+    float ba = float(perm(perm(xi + 1) + yi)) * (2.0 / 255.0) - 1.0;
+    float bb = float(perm(perm(xi + 1) + yi + 1)) * (2.0 / 255.0) - 1.0;
+    return (mix(mix(aa, ba, u), mix(ab, bb, u), v) + 1.0) / 2.0;
+}
+
+float noise2D(vec2 p) {
+    if (noiseBasis == 1) return simplex2D(p);
+    if (noiseBasis == 2) return value2D(p);
+    return perlin2D(p);
+}
+
+float terrainHeight(vec2 worldXZ) {
+    vec2 p = worldXZ / horizontalScale;
+    float total = 0.0;
+    float frequency = 1.0;
+    float amplitude = 1.0;
+    float maxValue = 0.0;
+    for (int i = 0; i < octaves; i++) {
+        total += noise2D(p * frequency) * amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+    return peakHeight * (total / maxValue - 0.5) * 2.0;
+}
+// ---------------------------------------------------------------------------------------------
+
+// ---- Toroidal height map (Heightmap mode), see TerrainHeightRing ----
+uniform sampler2D heightMap;     // resolution^2 R32F, sample (x, z) lives in slot ((x + ringOffsetX) % R, (z + ringOffsetZ) % R)
+uniform int gridResolution;
+uniform int ringOffsetX;
+uniform int ringOffsetZ;
+
+float heightMapAt(int x, int z) {
+    x = clamp(x, 0, gridResolution - 1);
+    z = clamp(z, 0, gridResolution - 1);
+    ivec2 slot = ivec2((x + ringOffsetX) % gridResolution, (z + ringOffsetZ) % gridResolution);
+    return texelFetch(heightMap, slot, 0).r;
+}
+// ---------------------------------------------------------------------------------------------
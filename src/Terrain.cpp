@@ -1,5 +1,6 @@
 #include "Terrain.hpp"
 #include "Camera.hpp"
+#include <algorithm>
 #include <cmath>
 #include <glm/detail/func_common.hpp>
 #include <glm/detail/type_mat.hpp>
@@ -7,6 +8,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/glm.hpp>
+#include <cstddef>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
@@ -18,6 +20,40 @@
     #pragma message("OpenMP is NOT enabled")
 #endif
 
+// Where terrain.vert and shadow_depth.vert take the terrain height from
+static const int HEIGHT_FROM_VERTICES = 0;
+static const int HEIGHT_FROM_GPU_NOISE = 1;
+static const int HEIGHT_FROM_HEIGHT_MAP = 2;
+static const int HEIGHT_FROM_PACKED_VERTICES = 3;
+static const int HEIGHT_MAP_TEXTURE_UNIT = 13;
+static const int PERM_TEXTURE_UNIT = 14;
+static const int MAX_CHUNK_LOAD_RADIUS = 16; // Bounds the loaded chunk count (~800) when flying high
+// Written by the terrain_bake tool, relative to the working directory like the shaders
+static const char* TILE_FILE_PATH = "../terrain_tiles.bin";
+
+// Quarter-unit cells: the snapping error is far below anything visible at this terrain scale
+const float Terrain::QUERY_CACHE_QUANTUM = 0.25f;
+const size_t Terrain::QUERY_CACHE_CAPACITY = 1 << 14;
+// 32x32 quads: about a hundred patches for the default 300 grid, few enough to test every frame
+const unsigned int Terrain::PATCH_QUADS = 32;
+
+
+/**
+ * @brief Normals of one grid row from central differences, one-sided at the ends.
+ * Not normalised (y is 1), the octahedral packing divides by the L1 norm anyway.
+ * @param down/row/up heights of rows z - 1, z, z + 1 (clamped at the grid edge)
+ * @param invDz 1 / (z distance between down and up)
+ */
+static void computeGridRowNormals(const float* down, const float* row, const float* up, int count,
+                                  float spacing, float invDz, glm::vec3* out) {
+    const float invDx = 1.0f / (2.0f * spacing);
+    // Interior: no branches, no neighbour clamping
+    for (int x = 1; x < count - 1; x++) {
+        out[x] = glm::vec3((row[x - 1] - row[x + 1]) * invDx, 1.0f, (down[x] - up[x]) * invDz);
+    }
+    out[0] = glm::vec3((row[0] - row[1]) / spacing, 1.0f, (down[0] - up[0]) * invDz);
+    out[count - 1] = glm::vec3((row[count - 2] - row[count - 1]) / spacing, 1.0f, (down[count - 1] - up[count - 1]) * invDz);
+}
 
 Terrain::Terrain(glm::vec3 _scale, int _resolution) {
     // Position of terrain is speacial, because it will need to match the camera
@@ -37,25 +73,56 @@ Terrain::Terrain(glm::vec3 _scale, int _resolution) {
     pn = PerlinNoise(-1);
 
     modeWireframe = false;
+    mode = TerrainMode::Chunked;
+    permTextureID = 0;
+    heightMapTextureID = 0;
+    lastSamplesComputed = 0;
+    lastUploadBytes = 0;
+    gridPatches = nullptr;
+    lastPatchesDrawn = 0;
+    lastShadowPatchDraws = 0;
+    gridDirty = true;
+    regenerationsPerformed = 0;
+    regenerationsSkipped = 0;
+    noiseGeneration = 0;
+    queryCacheHits = 0;
+    queryCacheMisses = 0;
 
     consistencyFactor = resolution / scale.x;
 
+    noiseParams.octaves = octaves;
+    noiseParams.persistence = persistence;
+    noiseParams.lacunarity = lacunarity;
+    noiseParams.peakHeight = peakHeight;
+    noiseParams.horizontalScale = scale.x;
+    noiseParams.seed = pn.getSeed();
+    noiseParams.basis = pn.getBasis();
+    noiseParams.updateSchedule();
+
+    heightRing.resize(resolution);
+
     index_buffer_data = generate_grid_indices_acw(resolution);
     // Populate vertex_buffer_data to form a grid of 16 * 16
     // in a 1x1 area
+    const float step = 1.0f / (float)resolution;
+    const float uStart = static_cast<float>(offset.x * consistencyFactor) / (float)resolution - 0.5f;
+    const float vStart = static_cast<float>(offset.z * consistencyFactor) / (float)resolution - 0.5f;
+    // Row-coherent noise with the rows split across threads, this runs before the window shows anything
+    std::vector<float> initialHeights(resolution * resolution);
+    const OctaveSchedule initialSchedule(octaves, persistence, lacunarity);
+    #pragma omp parallel for
+    for (int z = 0; z < resolution; z++) {
+        pn.octavePerlinGrid(uStart, vStart + z * step, step, resolution, 1, &initialHeights[z * resolution], initialSchedule);
+    }
+    vertex_buffer_data.reserve(initialHeights.size());
     for (int z = 0; z < resolution; z++) {
         for (int x = 0; x < resolution; x++) {
-            float u0 = static_cast<float>(x) / (float)resolution - 0.5f;
-            float v0 = static_cast<float>(z) / (float)resolution - 0.5f;
-            
-            float u = u0 + static_cast<float>(offset.x * consistencyFactor) / (float)resolution;
-            float v = v0 + static_cast<float>(offset.z * consistencyFactor) / (float)resolution;
-            
-            float h =  pn.octavePerlin(u, v, octaves, persistence, lacunarity);
+            float u = uStart + x * step;
+            float v = vStart + z * step;
             // Map u.v to [-1, 1] * scale
             glm::vec3 coords = glm::vec3(
                 scale.x * (u),
-                peakHeight * h,
+                peakHeight * initialHeights[x + z * resolution],
                 scale.z * (v)
             );
             vertex_buffer_data.push_back(coords);
@@ -87,6 +154,11 @@ void Terrain::initialize(std::shared_ptr<Shader> shaderptr, glm::vec3 position)
     this->position = position;
     this->scale = scale;
 
+    // Patch-ordered strip indices shared with every other grid of this resolution
+    gridPatches = &GridIndexCache::getPatched(resolution, PATCH_QUADS);
+    // Until the first regeneration the heights are unknown, so no patch can be culled by height
+    patchHeightRanges.assign(gridPatches->counts.size(), glm::vec2(-peakHeight, peakHeight));
+
     glGenVertexArrays(1, &vertexArrayID);
 
     
@@ -104,13 +176,50 @@ void Terrain::initialize(std::shared_ptr<Shader> shaderptr, glm::vec3 position)
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(2);
     
-    glGenBuffers(1, &indexBufferID);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferID);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * index_buffer_data.size(), &index_buffer_data[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridPatches->bufferID);
 
 
     glBindVertexArray(0);
 
+    // Grid mode rewrites heights/normals every time it regenerates, so it streams them in the packed format
+    vertexStream.initialize(GL_ARRAY_BUFFER, sizeof(PackedTerrainVertex) * vertex_buffer_data.size());
+    glGenVertexArrays(1, &streamVertexArrayID);
+    glBindVertexArray(streamVertexArrayID);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexStream.getBufferID());
+    glEnableVertexAttribArray(5);
+    glEnableVertexAttribArray(6);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridPatches->bufferID);
+    glBindVertexArray(0);
+    // Something valid to draw before the first update
+    PackedTerrainVertex* packed = static_cast<PackedTerrainVertex*>(vertexStream.beginWrite());
+    for (size_t i = 0; i < vertex_buffer_data.size(); i++) {
+        packed[i] = packTerrainVertex(vertex_buffer_data[i].y, getPackedHeightScale(), normal_buffer_data[i]);
+    }
+    vertexStream.endWrite();
+    bindPackedStreamRegion();
+    std::cout << "[Terrain] Grid vertex streaming: "
+              << (vertexStream.isPersistent() ? "persistent mapped (ARB_buffer_storage)" : "mapped per frame")
+              << ", " << StreamBuffer::REGION_COUNT << " regions of " << vertexStream.getRegionSize() << " bytes"
+              << " (" << sizeof(PackedTerrainVertex) << " bytes/vertex, was " << 2 * sizeof(glm::vec3) << ")\n";
+
+    chunkManager.initialize();
+    loadTileFile(TILE_FILE_PATH);
+    clipmap.initialize();
+    clipmapShader = std::make_shared<Shader>("../shaders/terrain_clipmap.vert", "../shaders/terrain.frag");
+
+    glGenTextures(1, &permTextureID);
+    uploadPermutationTexture();
+
+    // Toroidal heightfield for Heightmap mode, filled on the first update
+    glGenTextures(1, &heightMapTextureID);
+    glBindTexture(GL_TEXTURE_2D, heightMapTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, resolution, resolution, 0, GL_RED, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    heightMapColumn.resize(resolution);
     
     this->shader = shaderptr;
     if (shaderptr->getProgramID() == 0) {
@@ -118,24 +227,116 @@ void Terrain::initialize(std::shared_ptr<Shader> shaderptr, glm::vec3 position)
     }
 }
 
+void Terrain::uploadPermutationTexture() {
+    // Permutation table for the GPU noise path (p[i + 256] == p[i], so 256 entries are enough)
+    unsigned char permutation[256];
+    for (int i = 0; i < 256; i++) {
+        permutation[i] = static_cast<unsigned char>(pn.getPermutation(i));
+    }
+    glBindTexture(GL_TEXTURE_2D, permTextureID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, 256, 1, 0, GL_RED_INTEGER, GL_UNSIGNED_BYTE, permutation);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Terrain::setNoiseSeed(unsigned int seed) {
+    if (seed == pn.getSeed()) return;
+    pn = PerlinNoise(-1, seed, pn.getBasis());
+    noiseParams.seed = seed;
+    bumpNoiseGeneration();
+    // The height mapping changed, noiseParams now differs so every mode regenerates
+    if (permTextureID != 0) {
+        uploadPermutationTexture();
+    }
+}
+
+void Terrain::setNoiseBasis(NoiseBasis basis) {
+    if (basis == pn.getBasis()) return;
+    pn.setBasis(basis);
+    noiseParams.basis = basis;
+    bumpNoiseGeneration();
+}
+
 void Terrain::setNoiseParams(int octaves, float persistence, float lacunarity) {
+    // Called every UI frame, only rebuild the octave schedule on a real change
+    if (octaves == this->octaves && persistence == this->persistence && lacunarity == this->lacunarity) return;
     this->octaves = octaves;
     this->persistence = persistence;
     this->lacunarity = lacunarity;
+    noiseParams.octaves = octaves;
+    noiseParams.persistence = persistence;
+    noiseParams.lacunarity = lacunarity;
+    noiseParams.updateSchedule();
+    bumpNoiseGeneration();
 }
 
 void Terrain::setPeakHeight(float peakHeight) {
+    if (peakHeight == this->peakHeight) return;
     this->peakHeight = peakHeight;
+    noiseParams.peakHeight = peakHeight;
+    bumpNoiseGeneration();
+}
+
+void Terrain::bumpNoiseGeneration() {
+    // Cached queries carry the generation they were computed for, so this invalidates them all at once
+    noiseGeneration++;
+}
+
+void Terrain::setMode(TerrainMode mode) {
+    if (mode != this->mode) {
+        // Grid keeps heights in the vertex buffer and Heightmap in a texture, the new one is stale
+        gridDirty = true;
+    }
+    this->mode = mode;
+}
+
+void Terrain::resetRegenerationCounters() {
+    regenerationsPerformed = 0;
+    regenerationsSkipped = 0;
+}
+
+const TerrainNoiseParams& Terrain::getNoiseParams() const {
+    return noiseParams;
 }
 
 float Terrain::getCenterHeight() {
-    return vertex_buffer_data[(resolution / 2) + (resolution / 2) * resolution].y;
+    // The grid is only regenerated in grid mode, otherwise ask the noise directly
+    if (mode != TerrainMode::Grid && mode != TerrainMode::Heightmap) {
+        return getHeightAt(offset.x, offset.z);
+    }
+    return heightRing.at(resolution / 2, resolution / 2);
+}
+
+float Terrain::getGroundHeight(float worldX, float worldZ) const {
+    // Interpolate the heights the current mode already generated, noise only outside them
+    float height;
+    switch (mode) {
+        case TerrainMode::Grid:
+        case TerrainMode::Heightmap:
+            if (heightRing.sampleBilinear(worldX, worldZ, height)) return height;
+            break;
+        case TerrainMode::Chunked:
+            if (chunkManager.sampleHeight(worldX, worldZ, height)) return height;
+            break;
+        case TerrainMode::Clipmap:
+            if (clipmap.sampleHeight(worldX, worldZ, height)) return height;
+            break;
+        default:
+            break; // GPUNoise keeps no heights on the CPU
+    }
+    return getHeightAt(worldX, worldZ);
 }
 
 bool Terrain::groundHeightConstraint(glm::vec3 &position) {
     // Always be 50 units above the ground
-    if (position.y < getCenterHeight() + 50) {
-        position.y = getCenterHeight() + 50;
+    float groundHeight = getGroundHeight(position.x, position.z);
+    if (position.y < groundHeight + 50) {
+        position.y = groundHeight + 50;
         return true;
     }
     return false;
@@ -145,7 +346,28 @@ void Terrain::setWireframeMode(bool enabled) {
     modeWireframe = enabled;
 }
 
+void Terrain::initializeDepthShader(std::shared_ptr<Shader> depthShader) {
+    // Both samplers must point at different units or every draw with this program is invalid,
+    // models included, whatever the terrain mode
+    depthShader->use();
+    depthShader->setUniInt("permTexture", PERM_TEXTURE_UNIT);
+    depthShader->setUniInt("heightMap", HEIGHT_MAP_TEXTURE_UNIT);
+    glUseProgram(0);
+}
+
 void Terrain::renderDepth(std::shared_ptr<Shader> depthShader, const LightingParams& lightingParams) {
+    if (mode == TerrainMode::Chunked || mode == TerrainMode::Clipmap) {
+        depthShader->use();
+        depthShader->setUniMat4("nodeMatrix", glm::mat4(1.0f));
+        depthShader->setUniBool("isSkinned", false);
+        if (mode == TerrainMode::Chunked) {
+            chunkManager.renderDepth(depthShader, lightingParams.lightPosition);
+        } else {
+            clipmap.renderDepth(depthShader);
+        }
+        return;
+    }
+
     // This is called from within the shadow map FBO
     // Just render the terrain with the model matrix
     glm::mat4 modelMatrix = glm::mat4();
@@ -157,40 +379,105 @@ void Terrain::renderDepth(std::shared_ptr<Shader> depthShader, const LightingPar
     depthShader->setUniMat4("Model", modelMatrix);
     depthShader->setUniMat4("nodeMatrix", glm::mat4(1.0f));  // Identity - terrain has no node hierarchy
     depthShader->setUniBool("isSkinned", false);
+    if (mode == TerrainMode::GPUNoise) {
+        depthShader->setUniInt("terrainHeightSource", HEIGHT_FROM_GPU_NOISE);
+        setGPUNoiseUniforms(depthShader);
+    } else if (mode == TerrainMode::Heightmap) {
+        depthShader->setUniInt("terrainHeightSource", HEIGHT_FROM_HEIGHT_MAP);
+        setHeightMapUniforms(depthShader);
+    } else {
+        depthShader->setUniInt("terrainHeightSource", HEIGHT_FROM_PACKED_VERTICES);
+        setPackedVertexUniforms(depthShader);
+    }
 
-    glBindVertexArray(vertexArrayID);
-    glDrawElements(GL_TRIANGLES, index_buffer_data.size(), GL_UNSIGNED_INT, 0);
+    glBindVertexArray(mode == TerrainMode::Grid ? streamVertexArrayID : vertexArrayID);
+    drawShadowCulledPatches(depthShader, lightingParams.lightPosition);
     glBindVertexArray(0);
-}
 
-void Terrain::render(glm::mat4 vp, const LightingParams& lightingParams, glm::vec3 cameraPos, float farPlane) {
-    glm::mat4 modelMatrix = glm::mat4();
-    modelMatrix = glm::translate(modelMatrix, position);
-    // Special scale factor:
-    modelMatrix = glm::scale(modelMatrix, specialScale);
-    
-    glm::mat4 mvp = vp * modelMatrix;
+    // The depth shader is shared with every model
+    depthShader->setUniInt("terrainHeightSource", HEIGHT_FROM_VERTICES);
+    depthShader->setUniInt("culledFaces", 0);
+}
 
-    shader->use();
-    shader->setUniMat4("MVP", mvp);
-    shader->setUniMat4("Model", modelMatrix);
+void Terrain::setLightingUniforms(std::shared_ptr<Shader> shader, const LightingParams& lightingParams, float farPlane) {
     shader->setUniVec3("lightPosition", lightingParams.lightPosition);
     shader->setUniVec3("lightColor", lightingParams.lightColor);
     shader->setUniVec3("lightIntensity", lightingParams.lightIntensity);
     shader->setUniInt("shadowCubemap", 15);  // Texture unit 15
     shader->setUniFloat("farPlane", farPlane);
-    
-    glBindVertexArray(vertexArrayID);
+    shader->setUniInt("permTexture", PERM_TEXTURE_UNIT);
+    shader->setUniInt("heightMap", HEIGHT_MAP_TEXTURE_UNIT);
+}
+
+void Terrain::setGPUNoiseUniforms(std::shared_ptr<Shader> shader) {
+    // Only the noise parameters cross the bus in GPUNoise mode
+    glActiveTexture(GL_TEXTURE0 + PERM_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, permTextureID);
+    shader->setUniInt("noiseBasis", static_cast<int>(pn.getBasis()));
+    shader->setUniInt("octaves", octaves);
+    shader->setUniFloat("persistence", persistence);
+    shader->setUniFloat("lacunarity", lacunarity);
+    shader->setUniFloat("peakHeight", peakHeight);
+    shader->setUniFloat("horizontalScale", scale.x);
+}
+
+void Terrain::setHeightMapUniforms(std::shared_ptr<Shader> shader) {
+    glActiveTexture(GL_TEXTURE0 + HEIGHT_MAP_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, heightMapTextureID);
+    glm::ivec2 ringOffset = heightRing.getRingOffset();
+    shader->setUniInt("gridResolution", resolution);
+    shader->setUniInt("ringOffsetX", ringOffset.x);
+    shader->setUniInt("ringOffsetZ", ringOffset.y);
+    shader->setUniFloat("normalEpsilon", heightRing.getCellSize());
+}
 
+void Terrain::render(glm::mat4 vp, const LightingParams& lightingParams, glm::vec3 cameraPos, float farPlane) {
     // Wireframe
     if (modeWireframe) {
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
     }
-    glDrawElements(GL_TRIANGLES, index_buffer_data.size(), GL_UNSIGNED_INT, 0);
-    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-    glBindVertexArray(0);
+    if (mode == TerrainMode::Chunked) {
+        // Chunks carry their own world-space model matrix
+        shader->use();
+        shader->setUniInt("heightSource", HEIGHT_FROM_VERTICES);
+        setLightingUniforms(shader, lightingParams, farPlane);
+        chunkManager.render(shader, vp);
+    } else if (mode == TerrainMode::Clipmap) {
+        clipmapShader->use();
+        setLightingUniforms(clipmapShader, lightingParams, farPlane);
+        clipmap.render(clipmapShader, vp, cameraPos);
+    } else {
+        glm::mat4 modelMatrix = glm::mat4();
+        modelMatrix = glm::translate(modelMatrix, position);
+        // Special scale factor:
+        modelMatrix = glm::scale(modelMatrix, specialScale);
+        
+        glm::mat4 mvp = vp * modelMatrix;
+
+        shader->use();
+        shader->setUniMat4("MVP", mvp);
+        shader->setUniMat4("Model", modelMatrix);
+        setLightingUniforms(shader, lightingParams, farPlane);
+
+        if (mode == TerrainMode::GPUNoise) {
+            shader->setUniInt("heightSource", HEIGHT_FROM_GPU_NOISE);
+            setGPUNoiseUniforms(shader);
+            shader->setUniFloat("normalEpsilon", specialScale.x * scale.x / resolution); // One grid cell
+        } else if (mode == TerrainMode::Heightmap) {
+            shader->setUniInt("heightSource", HEIGHT_FROM_HEIGHT_MAP);
+            setHeightMapUniforms(shader);
+        } else {
+            shader->setUniInt("heightSource", HEIGHT_FROM_PACKED_VERTICES);
+            setPackedVertexUniforms(shader);
+        }
+
+        glBindVertexArray(mode == TerrainMode::Grid ? streamVertexArrayID : vertexArrayID);
+        drawCulledPatches(Frustum(vp));
+        glBindVertexArray(0);
+    }
 
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 };
 
 void Terrain::update(float deltaTime){
@@ -199,90 +486,276 @@ void Terrain::update(float deltaTime){
     const float originalHeight = 300.0f; //! TODO: UPDATE THIS IF WE CHANGE CAMERA
     specialScale =  glm::max(2.5f, heightFromGround / originalHeight) *  glm::vec3(1, 0, 1) + glm::vec3(0, 1, 0);
 
-    // Update perlin noise height
-    float offsetU = offset.x * consistencyFactor;
-    float offsetV = offset.z * consistencyFactor;
-
-    #pragma omp parallel for
-    for (int z = 0; z < resolution; z++) {
-        float v0 = specialScale.z * (static_cast<float>(z) / (float)resolution - 0.5);
-        #pragma omp parallel for
-        for (int x = 0; x < resolution; x++) {
-            float u0 = specialScale.x * (static_cast<float>(x) / (float)resolution - 0.5);
+    if (mode == TerrainMode::Chunked) {
+        // Load as far as the grid reaches at this altitude (half its scaled extent)
+        int radius = static_cast<int>(std::ceil(0.5f * scale.x * specialScale.x / chunkManager.getChunkSize()));
+        chunkManager.setLoadRadius(std::min(radius, MAX_CHUNK_LOAD_RADIUS));
+        // Chunks only regenerate when they enter range or the noise changes
+        chunkManager.setNoise(pn, getNoiseParams());
+        chunkManager.update(offset);
+        return;
+    }
+    if (mode == TerrainMode::Clipmap) {
+        // Levels only regenerate when their snapped origin moves
+        clipmap.setNoise(pn, getNoiseParams());
+        clipmap.update(offset);
+        return;
+    }
+    if (mode == TerrainMode::GPUNoise) {
+        // Static grid, terrain.vert does the noise. Nothing to compute or upload.
+        return;
+    }
 
-            float u = u0 + static_cast<float>(offsetU) / (float)resolution;
-            float v = v0 + static_cast<float>(offsetV) / (float)resolution;
+    // Skip everything if nothing the heights depend on changed since the last regeneration
+    const TerrainNoiseParams& params = getNoiseParams();
+    if (!gridDirty && offset == lastOffset && specialScale == lastSpecialScale && params == lastParams) {
+        position = gridPosition; // updateOffset() moved it to the unsnapped camera position
+        lastUploadBytes = 0;
+        regenerationsSkipped++;
+        return;
+    }
+    lastOffset = offset;
+    lastSpecialScale = specialScale;
+    lastParams = params;
+
+    scrollHeightRing(gridDirty);
+    gridDirty = false;
+    if (lastSamplesComputed == 0) {
+        // Moved less than a cell, the snapped grid is unchanged
+        lastUploadBytes = 0;
+        regenerationsSkipped++;
+        return;
+    }
+    regenerationsPerformed++;
+    updatePatchHeightRanges();
 
-            float h = pn.octavePerlin(u, v, octaves, persistence, lacunarity);
+    if (mode == TerrainMode::Heightmap) {
+        // terrain.vert reads the heights straight from the texture
+        uploadHeightMap();
+        return;
+    }
 
-            vertex_buffer_data[x + z * resolution].y = peakHeight * (h - 0.5) * 2;
+    // Pack straight into this frame's region of the stream buffer, x/z come from gl_VertexID.
+    // Normals are central differences on the height grid: every vertex only reads its neighbours'
+    // heights, so rows are independent and nothing is scattered.
+    PackedTerrainVertex* packed = static_cast<PackedTerrainVertex*>(vertexStream.beginWrite());
+    const float heightScale = getPackedHeightScale();
+    const float spacing = scale.x / resolution; // Model space, the model matrix applies specialScale
+    #pragma omp parallel
+    {
+        // Rows z - 1, z, z + 1 in logical order
+        std::vector<float> rows(3 * resolution);
+        float* down = &rows[0];
+        float* row = &rows[resolution];
+        float* up = &rows[2 * resolution];
+        std::vector<glm::vec3> normals(resolution);
+
+        #pragma omp for
+        for (int z = 0; z < resolution; z++) {
+            int zDown = glm::max(z - 1, 0);
+            int zUp = glm::min(z + 1, resolution - 1);
+            heightRing.copyRow(zDown, down);
+            heightRing.copyRow(z, row);
+            heightRing.copyRow(zUp, up);
+
+            computeGridRowNormals(down, row, up, resolution, spacing, 1.0f / ((zUp - zDown) * spacing), &normals[0]);
+            PackedTerrainVertex* out = packed + z * resolution;
+            for (int x = 0; x < resolution; x++) {
+                out[x] = packTerrainVertex(row[x], heightScale, normals[x]);
+            }
         }
     }
+    vertexStream.endWrite();
+    lastUploadBytes = vertexStream.getRegionSize();
 
+    bindPackedStreamRegion();
+};
 
-    // - For averaging face normals
-    // std::fill(face_normals.begin(), face_normals.end(), glm::vec3(0.0f));
-
-    // #pragma omp parallel for
-    // for (int i = 0; i < index_buffer_data.size(); i += 3) {
-    //     glm::vec3 v0 = vertex_buffer_data[index_buffer_data[i]];
-    //     glm::vec3 v1 = vertex_buffer_data[index_buffer_data[i + 1]];
-    //     glm::vec3 v2 = vertex_buffer_data[index_buffer_data[i + 2]];
-
-    //     glm::vec3 normal = (glm::cross(v1 - v0, v2 - v0));
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i]].x += normal.x;
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i]].y += normal.y;
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i]].z += normal.z;
-
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i + 1]].x += normal.x;
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i + 1]].y += normal.y;
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i + 1]].z += normal.z;
-
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i + 2]].x += normal.x;
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i + 2]].y += normal.y;
-    //     #pragma omp atomic
-    //     face_normals[index_buffer_data[i + 2]].z += normal.z;
-    // }
-    // #pragma omp parallel for
-    // for (int i = 0; i < vertex_buffer_data.size(); i++) {
-    //     normal_buffer_data[i] = face_normals[i];
-    // }
-    
-    // - Faster but less accurate
-    #pragma omp parallel for
-    for (int i = 0; i < vertex_buffer_data.size(); i++) {
-        // Find the first face that this vertex is part of
-        // We know that vertex i:
-        // if i % resolution <= resolution - 2 and 
-        // if i // resolution <= resolution - 2 
-        // is in i, i + resolution, i + 1
-        int row = i / resolution;
-        int col = i % resolution;
-        if (col <= (resolution - 2) && row <= (resolution - 2)) {
-            glm::vec3 v0 = vertex_buffer_data[i];
-            glm::vec3 v1 = vertex_buffer_data[i + resolution];
-            glm::vec3 v2 = vertex_buffer_data[i + 1];
-            normal_buffer_data[i] = glm::cross(v1 - v0, v2 - v0);
+/**
+ * @brief Height range of every grid patch, from the ring the grid was just drawn from.
+ * Patches share their edge rows/columns, so those count towards both neighbours.
+ */
+void Terrain::updatePatchHeightRanges() {
+    const int patchQuads = static_cast<int>(PATCH_QUADS);
+    const int patchesPerSide = static_cast<int>(gridPatches->patchesPerSide);
+    patchHeightRanges.assign(patchesPerSide * patchesPerSide, glm::vec2(INFINITY, -INFINITY));
+    std::vector<float> row(resolution);
+    for (int z = 0; z < resolution; z++) {
+        heightRing.copyRow(z, &row[0]);
+        int pzLast = std::min(z / patchQuads, patchesPerSide - 1);
+        int pzFirst = (z % patchQuads == 0 && z > 0) ? pzLast - 1 : pzLast;
+        for (int px = 0; px < patchesPerSide; px++) {
+            int x0 = px * patchQuads;
+            int x1 = std::min(x0 + patchQuads, resolution - 1);
+            float lo = row[x0], hi = row[x0];
+            for (int x = x0 + 1; x <= x1; x++) {
+                lo = std::min(lo, row[x]);
+                hi = std::max(hi, row[x]);
+            }
+            for (int pz = pzFirst; pz <= pzLast; pz++) {
+                glm::vec2& range = patchHeightRanges[px + pz * patchesPerSide];
+                range.x = std::min(range.x, lo);
+                range.y = std::max(range.y, hi);
+            }
         }
     }
+}
 
-    glBindVertexArray(vertexArrayID);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferID);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertex_buffer_data.size(), &vertex_buffer_data[0], GL_DYNAMIC_DRAW);
+/**
+ * @brief World-space box of a grid patch, with the same model matrix render() uses
+ */
+void Terrain::getPatchBounds(int patch, glm::vec3& boxMin, glm::vec3& boxMax) const {
+    const int patchesPerSide = static_cast<int>(gridPatches->patchesPerSide);
+    const int px = patch % patchesPerSide;
+    const int pz = patch / patchesPerSide;
+    const int x0 = px * static_cast<int>(PATCH_QUADS);
+    const int z0 = pz * static_cast<int>(PATCH_QUADS);
+    const int x1 = std::min(x0 + static_cast<int>(PATCH_QUADS), resolution - 1);
+    const int z1 = std::min(z0 + static_cast<int>(PATCH_QUADS), resolution - 1);
+
+    // GPUNoise heights never reach the CPU, the noise stays within +-peakHeight.
+    // Packed heights are quantized, so leave a unit of slack.
+    glm::vec2 heights = mode == TerrainMode::GPUNoise ? glm::vec2(-peakHeight, peakHeight) : patchHeightRanges[patch];
+    glm::vec3 localMin(scale.x * (static_cast<float>(x0) / resolution - 0.5f), heights.x - 1.0f,
+                       scale.z * (static_cast<float>(z0) / resolution - 0.5f));
+    glm::vec3 localMax(scale.x * (static_cast<float>(x1) / resolution - 0.5f), heights.y + 1.0f,
+                       scale.z * (static_cast<float>(z1) / resolution - 0.5f));
+    boxMin = position + specialScale * localMin;
+    boxMax = position + specialScale * localMax;
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, normalBufferID);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * normal_buffer_data.size(), &normal_buffer_data[0], GL_DYNAMIC_DRAW);
+/**
+ * @brief Draw the patches inside the camera frustum with one glMultiDrawElements
+ */
+void Terrain::drawCulledPatches(const Frustum& frustum) {
+    visiblePatchCounts.clear();
+    visiblePatchOffsets.clear();
+    glm::vec3 boxMin, boxMax;
+    for (size_t i = 0; i < gridPatches->counts.size(); i++) {
+        getPatchBounds(static_cast<int>(i), boxMin, boxMax);
+        if (!frustum.intersectsBox(boxMin, boxMax)) continue;
+        visiblePatchCounts.push_back(gridPatches->counts[i]);
+        visiblePatchOffsets.push_back(gridPatches->offsets[i]);
+    }
+    lastPatchesDrawn = static_cast<int>(visiblePatchCounts.size());
+    GridIndexCache::drawPatches(visiblePatchCounts.data(), visiblePatchOffsets.data(), lastPatchesDrawn);
+}
+
+/**
+ * @brief Shadow pass: patches are grouped by which cube faces see them, and each group is one
+ * glMultiDrawElements with the other faces masked off in shadow_depth.geom (culledFaces).
+ */
+void Terrain::drawShadowCulledPatches(std::shared_ptr<Shader> depthShader, const glm::vec3& lightPosition) {
+    const size_t patchCount = gridPatches->counts.size();
+    patchFaceMasks.resize(patchCount);
+    bool maskUsed[64] = {};
+    glm::vec3 boxMin, boxMax;
+    for (size_t i = 0; i < patchCount; i++) {
+        getPatchBounds(static_cast<int>(i), boxMin, boxMax);
+        patchFaceMasks[i] = cubeFacesSeeingBox(lightPosition, boxMin, boxMax);
+        maskUsed[patchFaceMasks[i]] = true;
+    }
+
+    lastShadowPatchDraws = 0;
+    for (unsigned int mask = 1; mask < 64; mask++) {
+        if (!maskUsed[mask]) continue;
+        visiblePatchCounts.clear();
+        visiblePatchOffsets.clear();
+        for (size_t i = 0; i < patchCount; i++) {
+            if (patchFaceMasks[i] != mask) continue;
+            visiblePatchCounts.push_back(gridPatches->counts[i]);
+            visiblePatchOffsets.push_back(gridPatches->offsets[i]);
+        }
+        depthShader->setUniInt("culledFaces", static_cast<int>(~mask & 63u));
+        GridIndexCache::drawPatches(visiblePatchCounts.data(), visiblePatchOffsets.data(),
+                                    static_cast<GLsizei>(visiblePatchCounts.size()));
+        lastShadowPatchDraws += static_cast<int>(visiblePatchCounts.size());
+    }
+}
+
+/**
+ * @brief Point the streaming VAO at the region just written, no reallocation
+ */
+void Terrain::bindPackedStreamRegion() {
+    const GLintptr base = vertexStream.getRegionOffset();
+    const GLsizei stride = sizeof(PackedTerrainVertex);
+    glBindVertexArray(streamVertexArrayID);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexStream.getBufferID());
+    glVertexAttribPointer(5, 1, GL_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(base + offsetof(PackedTerrainVertex, height)));
+    glVertexAttribPointer(6, 2, GL_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(base + offsetof(PackedTerrainVertex, normal)));
     glBindVertexArray(0);
+}
 
-};
+float Terrain::getPackedHeightScale() const {
+    // Heights stay within +-peakHeight
+    return glm::max(peakHeight, 1.0f);
+}
+
+void Terrain::setPackedVertexUniforms(std::shared_ptr<Shader> shader) {
+    shader->setUniInt("gridResolution", resolution);
+    shader->setUniFloat("gridExtent", scale.x);
+    shader->setUniFloat("heightScale", getPackedHeightScale());
+}
+
+bool Terrain::loadTileFile(const std::string& path) {
+    std::shared_ptr<TerrainTileFile> file = std::make_shared<TerrainTileFile>();
+    if (!file->open(path)) {
+        std::cout << "[Terrain] No baked tiles at " << path << ", chunks are generated from noise" << std::endl;
+        chunkManager.setTileFile(nullptr);
+        return false;
+    }
+    // The chunk manager only reads it while the noise parameters match the bake
+    chunkManager.setTileFile(file);
+    return true;
+}
+
+/**
+ * @brief Snap the grid to whole cells around the camera and scroll the ring heightfield along.
+ * Only the rows/columns that came into view are sampled; a new cell size (altitude changed the
+ * special scale) or new noise parameters resample everything.
+ */
+void Terrain::scrollHeightRing(bool force) {
+    float cellSize = specialScale.x * scale.x / resolution;
+    glm::ivec2 originCell(
+        static_cast<int>(std::floor(offset.x / cellSize + 0.5f)),
+        static_cast<int>(std::floor(offset.z / cellSize + 0.5f))
+    );
+    lastSamplesComputed = heightRing.scrollTo(originCell, cellSize, pn, getNoiseParams(), force);
+
+    // Vertex (x, z) sits at world cell minCell + (x, z), so move the grid to match the snapped origin
+    int half = resolution / 2;
+    gridPosition = glm::vec3(
+        (originCell.x - half) * cellSize + 0.5f * resolution * cellSize,
+        0.0f,
+        (originCell.y - half) * cellSize + 0.5f * resolution * cellSize
+    );
+    position = gridPosition;
+}
+
+/**
+ * @brief Mirror the rows/columns the ring just rewrote into the height map texture
+ */
+void Terrain::uploadHeightMap() {
+    const std::vector<float>& heights = heightRing.getHeights();
+    glBindTexture(GL_TEXTURE_2D, heightMapTextureID);
+    if (heightRing.wasFullyRegenerated()) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, resolution, resolution, GL_RED, GL_FLOAT, heights.data());
+        lastUploadBytes = sizeof(float) * resolution * resolution;
+    } else {
+        lastUploadBytes = sizeof(float) * resolution
+            * (heightRing.getDirtySlotRows().size() + heightRing.getDirtySlotColumns().size());
+        for (int row : heightRing.getDirtySlotRows()) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, resolution, 1, GL_RED, GL_FLOAT, &heights[row * resolution]);
+        }
+        for (int column : heightRing.getDirtySlotColumns()) {
+            for (int z = 0; z < resolution; z++) {
+                heightMapColumn[z] = heights[column + z * resolution];
+            }
+            glTexSubImage2D(GL_TEXTURE_2D, 0, column, 0, 1, resolution, GL_RED, GL_FLOAT, heightMapColumn.data());
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
 /**
  * @brief 
@@ -294,30 +767,79 @@ void Terrain::updateOffset(glm::vec3 newOffset) {
     offset = newOffset;
 }
 
+const TerrainQuerySample& Terrain::sampleQuery(float worldX, float worldZ) const {
+    int32_t cellX = static_cast<int32_t>(std::floor(worldX / QUERY_CACHE_QUANTUM));
+    int32_t cellZ = static_cast<int32_t>(std::floor(worldZ / QUERY_CACHE_QUANTUM));
+    uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellZ);
+
+    auto it = queryCache.find(key);
+    if (it != queryCache.end() && it->second.generation == noiseGeneration) {
+        queryCacheHits++;
+        return it->second;
+    }
+    queryCacheMisses++;
+    if (it == queryCache.end() && queryCache.size() >= QUERY_CACHE_CAPACITY) {
+        // Mostly cells the camera has left behind, cheaper to start over than to track ages
+        queryCache.clear();
+    }
+
+    // Sample the cell centre so the answer does not depend on which query filled the cell
+    float sampleX = (cellX + 0.5f) * QUERY_CACHE_QUANTUM;
+    float sampleZ = (cellZ + 0.5f) * QUERY_CACHE_QUANTUM;
+    // One octave pass with analytic derivatives gives both the height and the normal
+    glm::vec3 h = terrainHeightAndGradientAt(pn, getNoiseParams(), sampleX, sampleZ);
+
+    TerrainQuerySample& sample = queryCache[key];
+    sample.generation = noiseGeneration;
+    sample.height = h.x;
+    // Normal of y = h(x, z): (-dh/dx, 1, -dh/dz)
+    sample.normal = glm::normalize(glm::vec3(-h.y, 1.0f, -h.z));
+    return sample;
+}
+
 float Terrain::getHeightAt(float worldX, float worldZ) const {
-    // Convert world coordinates to the same UV space used by the terrain
-    // The terrain uses: u = x / scale.x, v = z / scale.z (after offset adjustment)
-    float u = worldX / scale.x;
-    float v = worldZ / scale.z;
-    
-    float h = pn.octavePerlin(u, v, octaves, persistence, lacunarity);
-    return peakHeight * (h - 0.5f) * 2.0f;
+    // Same mapping the chunks are generated with: u = x / scale.x, v = z / scale.z
+    return sampleQuery(worldX, worldZ).height;
 }
 
 glm::vec3 Terrain::getNormalAt(float worldX, float worldZ) const {
-    // Use central differences to approximate the normal
-    const float epsilon = 1.0f;  // Small step in world units
-    
-    float hL = getHeightAt(worldX - epsilon, worldZ);
-    float hR = getHeightAt(worldX + epsilon, worldZ);
-    float hD = getHeightAt(worldX, worldZ - epsilon);
-    float hU = getHeightAt(worldX, worldZ + epsilon);
-    
-    // Compute tangent vectors
-    glm::vec3 tangentX(2.0f * epsilon, hR - hL, 0.0f);
-    glm::vec3 tangentZ(0.0f, hU - hD, 2.0f * epsilon);
-    
-    // Normal is cross product of tangents
-    glm::vec3 normal = glm::normalize(glm::cross(tangentZ, tangentX));
+    float height;
+    glm::vec3 normal;
+    getHeightAndNormalAt(worldX, worldZ, height, normal);
     return normal;
 }
+
+void Terrain::getHeightAndNormalAt(float worldX, float worldZ, float& height, glm::vec3& normal) const {
+    const TerrainQuerySample& sample = sampleQuery(worldX, worldZ);
+    height = sample.height;
+    normal = sample.normal;
+}
+
+void Terrain::getHeightsAt(const glm::vec2* positions, float* heights, size_t count) const {
+    const TerrainNoiseParams& params = getNoiseParams();
+    // Blocks of deinterleaved coordinates for terrainHeightsAt, on each thread's stack
+    const int BLOCK = 256;
+    const int blocks = static_cast<int>((count + BLOCK - 1) / BLOCK);
+    // A frame's worth of spawner queries is not worth waking the thread team for
+    #pragma omp parallel for if (blocks > 4)
+    for (int b = 0; b < blocks; b++) {
+        float xs[BLOCK], zs[BLOCK];
+        size_t start = static_cast<size_t>(b) * BLOCK;
+        int n = static_cast<int>(std::min(static_cast<size_t>(BLOCK), count - start));
+        for (int i = 0; i < n; i++) {
+            xs[i] = positions[start + i].x;
+            zs[i] = positions[start + i].y;
+        }
+        terrainHeightsAt(pn, params, xs, zs, heights + start, n);
+    }
+}
+
+void Terrain::getNormalsAt(const glm::vec2* positions, glm::vec3* normals, size_t count) const {
+    const TerrainNoiseParams& params = getNoiseParams();
+    const int n = static_cast<int>(count);
+    #pragma omp parallel for if (n > 1024)
+    for (int i = 0; i < n; i++) {
+        glm::vec3 h = terrainHeightAndGradientAt(pn, params, positions[i].x, positions[i].y);
+        normals[i] = glm::normalize(glm::vec3(-h.y, 1.0f, -h.z));
+    }
+}
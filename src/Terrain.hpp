@@ -1,12 +1,40 @@
 #ifndef TERRAIN_HPP
 #define TERRAIN_HPP
+#include "GridIndexCache.hpp"
+#include "Frustum.hpp"
 #include "Perlin.hpp"
 #include "Shader.hpp"
 #include "Entities.hpp"
 #include "utils.hpp"
 #include "LightingParams.hpp"
+#include "StreamBuffer.hpp"
+#include "TerrainParams.hpp"
+#include "TerrainChunks.hpp"
+#include "TerrainClipmap.hpp"
+#include "TerrainHeightRing.hpp"
+#include "TerrainTiles.hpp"
+#include "TerrainVertex.hpp"
 #include <glm/detail/type_vec.hpp>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
+
+// How the terrain geometry is produced
+enum class TerrainMode {
+    Grid,       // One camera-centred grid, scrolled on the CPU, only new rows/columns are sampled
+    Chunked,    // Fixed world-space chunks streamed in by worker threads
+    Clipmap,    // Nested rings at doubling spacing around the camera, geomorphed
+    GPUNoise,   // Static grid, heights and normals sampled from noise in terrain.vert
+    Heightmap   // Static grid, heights read from a toroidal texture that only gets new rows/columns uploaded
+};
+
+// One cached point query: height and unit normal at a quantized world XZ
+struct TerrainQuerySample {
+    unsigned long generation; // Terrain::noiseGeneration it was computed for, older entries are stale
+    float height;
+    glm::vec3 normal;
+};
 
 class Terrain : public DynamicEntity {
     protected:
@@ -19,8 +47,11 @@ class Terrain : public DynamicEntity {
         // OpenGL Buffers
         GLuint vertexArrayID;
         GLuint vertexBufferID;
-        GLuint indexBufferID;
+        const GridPatchIndexBuffer* gridPatches; // Shared, owned by GridIndexCache; patches are culled one by one
         GLuint normalBufferID;
+        // Grid mode: packed heights/normals streamed through triple-buffered regions
+        GLuint streamVertexArrayID;
+        StreamBuffer vertexStream;
 
         // 
         PerlinNoise pn;
@@ -33,6 +64,39 @@ class Terrain : public DynamicEntity {
         float peakHeight;
 
         bool modeWireframe;
+        TerrainMode mode;
+        TerrainChunkManager chunkManager;
+        TerrainClipmap clipmap;
+        std::shared_ptr<Shader> clipmapShader;
+        GLuint permTextureID; // Permutation table for GPUNoise mode
+        TerrainHeightRing heightRing; // Heights of the camera-centred grid (Grid and Heightmap modes)
+        glm::vec3 gridPosition;       // Grid centre snapped to whole cells
+        GLuint heightMapTextureID;    // heightRing mirrored on the GPU for Heightmap mode
+        std::vector<float> heightMapColumn; // Scratch for column uploads
+        int lastSamplesComputed;      // Noise samples evaluated in the last update, for debugging
+        size_t lastUploadBytes;       // Bytes sent to the GPU by the last update, for debugging
+        std::vector<glm::vec2> patchHeightRanges; // (min, max) height of each grid patch, from heightRing
+        std::vector<GLsizei> visiblePatchCounts;  // Scratch for glMultiDrawElements
+        std::vector<const void*> visiblePatchOffsets;
+        std::vector<unsigned int> patchFaceMasks; // Scratch: shadow cube faces that see each patch
+        int lastPatchesDrawn;         // Grid patches that passed the frustum test in the last render
+        int lastShadowPatchDraws;     // Patch draws (summed over face groups) in the last depth pass
+
+        TerrainNoiseParams noiseParams; // Kept in sync by the setters, holds the prebuilt octave schedule
+        unsigned long noiseGeneration;  // Bumped whenever noiseParams changes, invalidates queryCache
+
+        // Point queries (getHeightAt, getHeightAndNormalAt) snapped to QUERY_CACHE_QUANTUM and memoised.
+        // Main thread only: the cache is mutated from const queries.
+        mutable std::unordered_map<uint64_t, TerrainQuerySample> queryCache;
+        mutable unsigned long queryCacheHits;
+        mutable unsigned long queryCacheMisses;
+        // Inputs of the last grid regeneration, update() skips the noise pass and upload if none changed
+        glm::vec3 lastOffset;
+        glm::vec3 lastSpecialScale;
+        TerrainNoiseParams lastParams;
+        bool gridDirty;               // Force the next regeneration (first frame, mode switch)
+        unsigned long regenerationsPerformed;
+        unsigned long regenerationsSkipped;
 
         // For computing the special scale factor
         float fov;
@@ -41,26 +105,82 @@ class Terrain : public DynamicEntity {
         float consistencyFactor;
 
 
+        void setLightingUniforms(std::shared_ptr<Shader> shader, const LightingParams& lightingParams, float farPlane);
+        void setGPUNoiseUniforms(std::shared_ptr<Shader> shader);
+        void uploadPermutationTexture();
+        void setHeightMapUniforms(std::shared_ptr<Shader> shader);
+        void scrollHeightRing(bool force);
+        void uploadHeightMap();
+        void bindPackedStreamRegion();
+        float getPackedHeightScale() const;
+        void setPackedVertexUniforms(std::shared_ptr<Shader> shader);
+        void bumpNoiseGeneration();
+        void updatePatchHeightRanges();
+        void getPatchBounds(int patch, glm::vec3& boxMin, glm::vec3& boxMax) const;
+        void drawCulledPatches(const Frustum& frustum);
+        void drawShadowCulledPatches(std::shared_ptr<Shader> depthShader, const glm::vec3& lightPosition);
+        const TerrainQuerySample& sampleQuery(float worldX, float worldZ) const;
+
     public:
         Terrain(glm::vec3 _scale, int _resolution);
         void render(glm::mat4 vp, const LightingParams& lightingParams, glm::vec3 cameraPos, float farPlane) override;
         void renderDepth(std::shared_ptr<Shader> depthShader, const LightingParams& lightingParams);
+        // Point the shadow depth shader's terrain samplers at the terrain's texture units, once after creating it
+        void initializeDepthShader(std::shared_ptr<Shader> depthShader);
         void update(float deltaTime) override;
         void updateOffset(glm::vec3 newOffset);
         void initialize(std::shared_ptr<Shader> shaderptr, glm::vec3 position);
         void setNoiseParams(int octaves, float persistence, float lacunarity);
+        void setNoiseSeed(unsigned int seed);
+        void setNoiseBasis(NoiseBasis basis);
         void setPeakHeight(float peakHeight);
+        // Map a file written by terrain_bake, Chunked mode reads its tiles instead of sampling noise
+        bool loadTileFile(const std::string& path);
         float getCenterHeight();
 
+        // Height under a world position, bilinear from the generated heights where the current mode has them
+        float getGroundHeight(float worldX, float worldZ) const;
         bool groundHeightConstraint(glm::vec3 &position);
         void setWireframeMode(bool enabled);
+        void setMode(TerrainMode mode);
+        TerrainMode getMode() const { return mode; }
+        const TerrainChunkManager& getChunkManager() const { return chunkManager; }
+        const TerrainClipmap& getClipmap() const { return clipmap; }
+        int getLastSamplesComputed() const { return lastSamplesComputed; }
+        size_t getLastUploadBytes() const { return lastUploadBytes; }
+        int getPatchCount() const { return static_cast<int>(gridPatches ? gridPatches->counts.size() : 0); }
+        int getLastPatchesDrawn() const { return lastPatchesDrawn; }
+        int getLastShadowPatchDraws() const { return lastShadowPatchDraws; }
+        unsigned long getRegenerationsPerformed() const { return regenerationsPerformed; }
+        unsigned long getRegenerationsSkipped() const { return regenerationsSkipped; }
+        void resetRegenerationCounters();
+        unsigned long getNoiseGeneration() const { return noiseGeneration; }
+        size_t getQueryCacheSize() const { return queryCache.size(); }
+        unsigned long getQueryCacheHits() const { return queryCacheHits; }
+        unsigned long getQueryCacheMisses() const { return queryCacheMisses; }
+
+        static const float QUERY_CACHE_QUANTUM;    // World units per query cache cell
+        static const size_t QUERY_CACHE_CAPACITY;  // Entries before the cache is flushed
+        static const unsigned int PATCH_QUADS;     // Quads per side of a culling patch of the grid
+
+        // Current height mapping (with its octave schedule), copy it before handing it to other threads
+        const TerrainNoiseParams& getNoiseParams() const;
 
-        // Query terrain height/normal at arbitrary world coordinates
+        // Query terrain height/normal at arbitrary world coordinates.
+        // Served from queryCache, so positions are snapped to QUERY_CACHE_QUANTUM world units.
         float getHeightAt(float worldX, float worldZ) const;
         glm::vec3 getNormalAt(float worldX, float worldZ) const;
+        // Both in one noise evaluation, cheaper than getHeightAt + getNormalAt
+        void getHeightAndNormalAt(float worldX, float worldZ, float& height, glm::vec3& normal) const;
+        // Batched versions for many points at once (positions are world (x, z)). Exact positions, not cached:
+        // heights go through the SIMD noise, large batches are split across OpenMP threads.
+        void getHeightsAt(const glm::vec2* positions, float* heights, size_t count) const;
+        void getNormalsAt(const glm::vec2* positions, glm::vec3* normals, size_t count) const;
 
         // Expose terrain parameters for external queries
         const PerlinNoise& getPerlinNoise() const { return pn; }
+        unsigned int getNoiseSeed() const { return pn.getSeed(); }
+        NoiseBasis getNoiseBasis() const { return pn.getBasis(); }
         int getOctaves() const { return octaves; }
         float getPersistence() const { return persistence; }
         float getLacunarity() const { return lacunarity; }
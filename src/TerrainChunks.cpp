@@ -0,0 +1,358 @@
+#include "TerrainChunks.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+TerrainChunkManager::TerrainChunkManager()
+    : chunkSize(1000.0f)
+    , chunkResolution(41)
+    , loadRadius(4)
+    , maxUploadsPerFrame(4)
+    , lastChunksDrawn(0)
+    , pn(-1)
+    , hasParams(false)
+    , bakedChunks(0)
+    , generatedChunks(0)
+    , generation(0)
+    , cameraChunkX(0)
+    , cameraChunkZ(0)
+{
+    gridIndices.bufferID = 0;
+    gridIndices.count = 0;
+}
+
+TerrainChunkManager::~TerrainChunkManager() {
+    // Join the workers before the completed queue goes away
+    pool.reset();
+    cleanup();
+}
+
+void TerrainChunkManager::initialize(float chunkSize, int chunkResolution, int loadRadius) {
+    this->chunkSize = chunkSize;
+    this->chunkResolution = chunkResolution;
+    this->loadRadius = loadRadius;
+
+    if (!pool) {
+        pool.reset(new ThreadPool());
+    }
+
+    // Every chunk has the same topology, so they all share one index buffer
+    gridIndices = GridIndexCache::get(chunkResolution);
+    updateActiveTiles();
+
+    std::cout << "[TerrainChunkManager] Initialized with chunkSize=" << chunkSize
+              << ", chunkResolution=" << chunkResolution << ", loadRadius=" << loadRadius
+              << ", workers=" << pool->getThreadCount() << std::endl;
+}
+
+void TerrainChunkManager::setNoise(const PerlinNoise& pn, const TerrainNoiseParams& params) {
+    if (hasParams && params == this->params) return;
+
+    this->pn = pn;
+    this->params = params;
+    hasParams = true;
+    updateActiveTiles();
+
+    // Everything queued was for the old parameters
+    generation++;
+    if (pool) pool->clearPending();
+    pendingChunks.clear();
+}
+
+void TerrainChunkManager::setTileFile(std::shared_ptr<const TerrainTileFile> tileFile) {
+    this->tileFile = tileFile;
+    updateActiveTiles();
+}
+
+void TerrainChunkManager::setLoadRadius(int loadRadius) {
+    // Chunks between the old and new radius are evicted or queued by the next update
+    this->loadRadius = std::max(1, loadRadius);
+}
+
+void TerrainChunkManager::updateActiveTiles() {
+    bool usable = tileFile && hasParams && tileFile->matches(params, chunkSize, chunkResolution);
+    if (usable == (activeTiles != nullptr)) return;
+    activeTiles = usable ? tileFile : nullptr;
+    std::cout << "[TerrainChunkManager] " << (usable ? "Reading" : "Not reading")
+              << " baked tiles for the current terrain parameters" << std::endl;
+}
+
+int64_t TerrainChunkManager::chunkKey(int chunkX, int chunkZ) const {
+    return static_cast<int64_t>(chunkX) + static_cast<int64_t>(chunkZ) * 1000003LL;
+}
+
+bool TerrainChunkManager::inRange(int chunkX, int chunkZ, int centerX, int centerZ, int radius) const {
+    int dx = chunkX - centerX;
+    int dz = chunkZ - centerZ;
+    return dx * dx + dz * dz <= radius * radius;
+}
+
+glm::mat4 TerrainChunkManager::chunkModelMatrix(const Chunk& chunk) const {
+    glm::vec3 origin(chunk.coord.x * chunkSize, 0.0f, chunk.coord.y * chunkSize);
+    return glm::translate(glm::mat4(), origin);
+}
+
+void TerrainChunkManager::queueChunk(int chunkX, int chunkZ) {
+    int64_t key = chunkKey(chunkX, chunkZ);
+    unsigned int gen = generation;
+    pendingChunks[key] = gen;
+
+    // Copy everything the job needs, the worker must not read our members while we mutate them
+    PerlinNoise jobNoise = pn;
+    TerrainNoiseParams jobParams = params;
+    float jobChunkSize = chunkSize;
+    int jobResolution = chunkResolution;
+    int jobRadius = loadRadius + 1;
+    // Holding the file keeps the mapping alive even if the tiles are swapped while the job is queued
+    std::shared_ptr<const TerrainTileFile> jobTiles = activeTiles;
+
+    pool->enqueue([this, chunkX, chunkZ, gen, jobNoise, jobParams, jobChunkSize, jobResolution, jobRadius, jobTiles]() {
+        std::shared_ptr<ChunkData> data = std::make_shared<ChunkData>();
+        data->coord = glm::ivec2(chunkX, chunkZ);
+        data->generation = gen;
+
+        // Skip the work if the chunk went stale while it sat in the queue,
+        // but still report back so the main thread can clear its pending entry
+        bool stale = gen != generation
+            || !inRange(chunkX, chunkZ, cameraChunkX, cameraChunkZ, jobRadius);
+        if (!stale) {
+            const float* baked = jobTiles ? jobTiles->findTile(chunkX, chunkZ) : nullptr;
+            generateChunk(*data, jobNoise, jobParams, jobChunkSize, jobResolution, baked);
+            if (baked) bakedChunks++;
+            else generatedChunks++;
+        }
+
+        std::lock_guard<std::mutex> lock(completedMutex);
+        completedChunks.push_back(data);
+    });
+}
+
+void TerrainChunkManager::generateChunk(ChunkData& data, const PerlinNoise& pn, const TerrainNoiseParams& params,
+                                        float chunkSize, int chunkResolution, const float* bakedHeights) {
+    const int res = chunkResolution;
+    const int apronRes = res + 2;
+    const float spacing = chunkSize / static_cast<float>(res - 1);
+
+    // Heights including a one sample border so edge normals match the neighbouring chunk
+    std::vector<float> heights(apronRes * apronRes);
+    if (bakedHeights) {
+        std::memcpy(&heights[0], bakedHeights, sizeof(float) * heights.size());
+    } else {
+        terrainTileHeights(pn, params, data.coord, chunkSize, res, &heights[0]);
+    }
+
+    data.vertices.resize(res * res);
+    data.normals.resize(res * res);
+    for (int z = 0; z < res; z++) {
+        for (int x = 0; x < res; x++) {
+            int a = (x + 1) + (z + 1) * apronRes;
+            float hL = heights[a - 1];
+            float hR = heights[a + 1];
+            float hD = heights[a - apronRes];
+            float hU = heights[a + apronRes];
+
+            data.vertices[x + z * res] = glm::vec3(x * spacing, heights[a], z * spacing);
+            data.normals[x + z * res] = glm::normalize(glm::vec3(hL - hR, 2.0f * spacing, hD - hU));
+        }
+    }
+}
+
+void TerrainChunkManager::uploadChunk(const ChunkData& data) {
+    int64_t key = chunkKey(data.coord.x, data.coord.y);
+    auto it = chunks.find(key);
+
+    if (it != chunks.end()) {
+        // Regenerated chunk (new noise parameters), same size so just overwrite the contents
+        Chunk& chunk = it->second;
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBufferID);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * data.vertices.size(), &data.vertices[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.normalBufferID);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * data.normals.size(), &data.normals[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        chunk.generation = data.generation;
+        copyHeights(data, chunk);
+        return;
+    }
+
+    Chunk chunk;
+    chunk.coord = data.coord;
+    chunk.generation = data.generation;
+    copyHeights(data, chunk);
+
+    glGenVertexArrays(1, &chunk.vertexArrayID);
+    glBindVertexArray(chunk.vertexArrayID);
+
+    glGenBuffers(1, &chunk.vertexBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertexBufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * data.vertices.size(), &data.vertices[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(0);
+
+    glGenBuffers(1, &chunk.normalBufferID);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.normalBufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * data.normals.size(), &data.normals[0], GL_STATIC_DRAW);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+    glEnableVertexAttribArray(2);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, gridIndices.bufferID);
+
+    glBindVertexArray(0);
+
+    chunks[key] = chunk;
+}
+
+void TerrainChunkManager::copyHeights(const ChunkData& data, Chunk& chunk) {
+    chunk.heights.resize(data.vertices.size());
+    chunk.minHeight = INFINITY;
+    chunk.maxHeight = -INFINITY;
+    for (size_t i = 0; i < data.vertices.size(); i++) {
+        float h = data.vertices[i].y;
+        chunk.heights[i] = h;
+        chunk.minHeight = std::min(chunk.minHeight, h);
+        chunk.maxHeight = std::max(chunk.maxHeight, h);
+    }
+}
+
+void TerrainChunkManager::getChunkBounds(const Chunk& chunk, glm::vec3& boxMin, glm::vec3& boxMax) const {
+    boxMin = glm::vec3(chunk.coord.x * chunkSize, chunk.minHeight, chunk.coord.y * chunkSize);
+    boxMax = glm::vec3((chunk.coord.x + 1) * chunkSize, chunk.maxHeight, (chunk.coord.y + 1) * chunkSize);
+}
+
+bool TerrainChunkManager::sampleHeight(float worldX, float worldZ, float& height) const {
+    int chunkX = static_cast<int>(std::floor(worldX / chunkSize));
+    int chunkZ = static_cast<int>(std::floor(worldZ / chunkSize));
+    auto it = chunks.find(chunkKey(chunkX, chunkZ));
+    if (it == chunks.end() || it->second.generation != generation) return false;
+
+    const std::vector<float>& heights = it->second.heights;
+    const int res = chunkResolution;
+    const float spacing = chunkSize / static_cast<float>(res - 1);
+    float gx = (worldX - chunkX * chunkSize) / spacing;
+    float gz = (worldZ - chunkZ * chunkSize) / spacing;
+    return sampleGridBilinear([&heights, res](int x, int z) { return heights[x + z * res]; }, res, res, gx, gz, height);
+}
+
+void TerrainChunkManager::destroyChunk(Chunk& chunk) {
+    glDeleteBuffers(1, &chunk.vertexBufferID);
+    glDeleteBuffers(1, &chunk.normalBufferID);
+    glDeleteVertexArrays(1, &chunk.vertexArrayID);
+}
+
+void TerrainChunkManager::update(const glm::vec3& cameraPos) {
+    if (!pool || !hasParams) return;
+
+    int centerX = static_cast<int>(std::floor(cameraPos.x / chunkSize));
+    int centerZ = static_cast<int>(std::floor(cameraPos.z / chunkSize));
+    cameraChunkX = centerX;
+    cameraChunkZ = centerZ;
+
+    // 1. Take finished jobs off the workers and upload a bounded number of them
+    std::vector<std::shared_ptr<ChunkData>> finished;
+    {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        finished.swap(completedChunks);
+    }
+
+    int uploads = 0;
+    std::vector<std::shared_ptr<ChunkData>> deferred;
+    for (auto& data : finished) {
+        int64_t key = chunkKey(data->coord.x, data->coord.y);
+        auto pending = pendingChunks.find(key);
+        bool current = pending != pendingChunks.end() && pending->second == data->generation;
+        if (!current) continue; // Superseded by a newer job for the same chunk
+
+        if (data->vertices.empty() || !inRange(data->coord.x, data->coord.y, centerX, centerZ, loadRadius + 1)) {
+            pendingChunks.erase(pending);
+            continue;
+        }
+        if (uploads >= maxUploadsPerFrame) {
+            deferred.push_back(data);
+            continue;
+        }
+        uploadChunk(*data);
+        pendingChunks.erase(pending);
+        uploads++;
+    }
+    if (!deferred.empty()) {
+        std::lock_guard<std::mutex> lock(completedMutex);
+        completedChunks.insert(completedChunks.end(), deferred.begin(), deferred.end());
+    }
+
+    // 2. Free chunks that left the (slightly larger) eviction radius
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        if (!inRange(it->second.coord.x, it->second.coord.y, centerX, centerZ, loadRadius + 1)) {
+            destroyChunk(it->second);
+            it = chunks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // 3. Queue missing or outdated chunks, nearest rings first
+    unsigned int currentGeneration = generation;
+    for (int ring = 0; ring <= loadRadius; ring++) {
+        for (int dz = -ring; dz <= ring; dz++) {
+            for (int dx = -ring; dx <= ring; dx++) {
+                if (std::abs(dx) != ring && std::abs(dz) != ring) continue; // Only the ring's border
+                int cx = centerX + dx;
+                int cz = centerZ + dz;
+                if (!inRange(cx, cz, centerX, centerZ, loadRadius)) continue;
+
+                int64_t key = chunkKey(cx, cz);
+                if (pendingChunks.count(key) > 0) continue;
+                auto it = chunks.find(key);
+                if (it != chunks.end() && it->second.generation == currentGeneration) continue;
+
+                queueChunk(cx, cz);
+            }
+        }
+    }
+}
+
+void TerrainChunkManager::render(std::shared_ptr<Shader> shader, const glm::mat4& vp) {
+    Frustum frustum(vp);
+    glm::vec3 boxMin, boxMax;
+    lastChunksDrawn = 0;
+    for (auto& entry : chunks) {
+        const Chunk& chunk = entry.second;
+        getChunkBounds(chunk, boxMin, boxMax);
+        if (!frustum.intersectsBox(boxMin, boxMax)) continue;
+        lastChunksDrawn++;
+        glm::mat4 modelMatrix = chunkModelMatrix(chunk);
+        shader->setUniMat4("MVP", vp * modelMatrix);
+        shader->setUniMat4("Model", modelMatrix);
+
+        glBindVertexArray(chunk.vertexArrayID);
+        GridIndexCache::draw(gridIndices);
+    }
+    glBindVertexArray(0);
+}
+
+void TerrainChunkManager::renderDepth(std::shared_ptr<Shader> depthShader, const glm::vec3& lightPosition) {
+    glm::vec3 boxMin, boxMax;
+    for (auto& entry : chunks) {
+        const Chunk& chunk = entry.second;
+        getChunkBounds(chunk, boxMin, boxMax);
+        unsigned int faces = cubeFacesSeeingBox(lightPosition, boxMin, boxMax);
+        if (faces == 0) continue;
+        // shadow_depth.geom skips the faces that cannot see this chunk
+        depthShader->setUniInt("culledFaces", static_cast<int>(~faces & 63u));
+        depthShader->setUniMat4("Model", chunkModelMatrix(chunk));
+
+        glBindVertexArray(chunk.vertexArrayID);
+        GridIndexCache::draw(gridIndices);
+    }
+    glBindVertexArray(0);
+    depthShader->setUniInt("culledFaces", 0);
+}
+
+void TerrainChunkManager::cleanup() {
+    for (auto& entry : chunks) {
+        destroyChunk(entry.second);
+    }
+    chunks.clear();
+    pendingChunks.clear();
+    // The index buffer belongs to GridIndexCache
+}
@@ -0,0 +1,173 @@
+#ifndef TERRAINCHUNKS_HPP
+#define TERRAINCHUNKS_HPP
+
+#include "Frustum.hpp"
+#include "GridIndexCache.hpp"
+#include "Perlin.hpp"
+#include "Shader.hpp"
+#include "ThreadPool.hpp"
+#include "TerrainParams.hpp"
+#include "TerrainTiles.hpp"
+#include "utils.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Streams the terrain as fixed world-space chunks generated on worker threads.
+ *
+ * - The world is divided into chunkSize x chunkSize squares, each a chunkResolution^2 vertex grid
+ * - Chunks within loadRadius (in chunks) of the camera are queued on the ThreadPool
+ * - Workers compute heights and normals only, the main thread uploads each result once
+ * - Chunks stay cached (no regeneration) until they leave loadRadius + 1, then their buffers are freed
+ * - Changing the noise parameters bumps a generation counter; old chunks keep drawing until replaced
+ *
+ * Neighbouring chunks share their edge vertices and normals use a one sample apron, so there are no seams.
+ * With a baked TerrainTileFile for the current parameters, workers copy a chunk's heights from the mapped
+ * file and only fall back to noise for chunks outside the baked area.
+ */
+class TerrainChunkManager {
+public:
+    TerrainChunkManager();
+    ~TerrainChunkManager();
+
+    TerrainChunkManager(TerrainChunkManager const&) = delete;
+    TerrainChunkManager& operator=(TerrainChunkManager const&) = delete;
+
+    /**
+     * @brief Create the shared index buffer. Needs a GL context.
+     * @param chunkSize side length of a chunk in world units
+     * @param chunkResolution vertices per chunk side
+     * @param loadRadius radius (in chunks) around the camera that is kept loaded
+     */
+    void initialize(float chunkSize = 1000.0f, int chunkResolution = 41, int loadRadius = 4);
+
+    /**
+     * @brief Set the noise used for new chunks. Loaded chunks are regenerated only if the parameters differ.
+     */
+    void setNoise(const PerlinNoise& pn, const TerrainNoiseParams& params);
+
+    /**
+     * @brief Use pre-baked heights where available. Ignored while the file's parameters or tile layout
+     * differ from the current noise and chunk size, nullptr turns it off.
+     */
+    void setTileFile(std::shared_ptr<const TerrainTileFile> tileFile);
+
+    /**
+     * @brief Change how many chunks around the camera are kept loaded (at least 1). Takes effect on the next update.
+     */
+    void setLoadRadius(int loadRadius);
+
+    /**
+     * @brief Queue chunks entering range, upload finished ones and evict chunks out of range
+     */
+    void update(const glm::vec3& cameraPos);
+
+    /**
+     * @brief Draw the uploaded chunks inside the vp frustum. The shader must already be in use with its lighting uniforms set.
+     */
+    void render(std::shared_ptr<Shader> shader, const glm::mat4& vp);
+
+    /**
+     * @brief Draw the uploaded chunks with the shadow depth shader, each only into the cube faces
+     * (around lightPosition) that can see it
+     */
+    void renderDepth(std::shared_ptr<Shader> depthShader, const glm::vec3& lightPosition);
+
+    void cleanup();
+
+    // Accessors for UI/debugging
+    size_t getLoadedChunkCount() const { return chunks.size(); }
+    size_t getPendingChunkCount() const { return pendingChunks.size(); }
+    int getLastChunksDrawn() const { return lastChunksDrawn; }
+    float getChunkSize() const { return chunkSize; }
+    int getLoadRadius() const { return loadRadius; }
+    bool isUsingTileFile() const { return activeTiles != nullptr; }
+    unsigned int getBakedChunkCount() const { return bakedChunks; }
+    unsigned int getGeneratedChunkCount() const { return generatedChunks; }
+
+    /**
+     * @brief Bilinear height from the loaded chunk under a world position
+     * @return false if that chunk is not loaded or still has the previous noise parameters
+     */
+    bool sampleHeight(float worldX, float worldZ, float& height) const;
+
+private:
+    // A chunk as it lives on the GPU
+    struct Chunk {
+        glm::ivec2 coord;
+        unsigned int generation;
+        GLuint vertexArrayID;
+        GLuint vertexBufferID;
+        GLuint normalBufferID;
+        std::vector<float> heights;       // CPU copy of the vertex heights, for ground queries
+        float minHeight;                  // Height range of the vertices, for culling
+        float maxHeight;
+    };
+
+    // Output of a worker job, handed back to the main thread for upload
+    struct ChunkData {
+        glm::ivec2 coord;
+        unsigned int generation;
+        std::vector<glm::vec3> vertices;  // local to the chunk origin (x, z), absolute height (y)
+        std::vector<glm::vec3> normals;
+    };
+
+    float chunkSize;
+    int chunkResolution;
+    int loadRadius;
+    int maxUploadsPerFrame;
+    int lastChunksDrawn;
+
+    PerlinNoise pn;
+    TerrainNoiseParams params;
+    bool hasParams;
+
+    std::shared_ptr<const TerrainTileFile> tileFile;
+    std::shared_ptr<const TerrainTileFile> activeTiles; // tileFile if it matches params, else null
+    // Chunks filled from the tile file vs from noise, written by the workers
+    std::atomic<unsigned int> bakedChunks;
+    std::atomic<unsigned int> generatedChunks;
+
+    // Bumped whenever the noise changes, chunks with an older generation get regenerated
+    std::atomic<unsigned int> generation;
+    // Camera chunk as seen by the workers, so jobs that fell out of range can be skipped
+    std::atomic<int> cameraChunkX;
+    std::atomic<int> cameraChunkZ;
+
+    GridIndexBuffer gridIndices; // Shared, owned by GridIndexCache
+
+    std::unordered_map<int64_t, Chunk> chunks;
+    // Chunk key -> generation it was queued with
+    std::unordered_map<int64_t, unsigned int> pendingChunks;
+
+    std::mutex completedMutex;
+    std::vector<std::shared_ptr<ChunkData>> completedChunks;
+
+    // Declared last so workers are joined before anything they reference is destroyed
+    std::unique_ptr<ThreadPool> pool;
+
+    int64_t chunkKey(int chunkX, int chunkZ) const;
+    bool inRange(int chunkX, int chunkZ, int centerX, int centerZ, int radius) const;
+    glm::mat4 chunkModelMatrix(const Chunk& chunk) const;
+    void getChunkBounds(const Chunk& chunk, glm::vec3& boxMin, glm::vec3& boxMax) const;
+
+    void updateActiveTiles();
+    void queueChunk(int chunkX, int chunkZ);
+    void uploadChunk(const ChunkData& data);
+    static void copyHeights(const ChunkData& data, Chunk& chunk);
+    void destroyChunk(Chunk& chunk);
+
+    /**
+     * @brief Worker side: heights (with a one sample apron) and central difference normals
+     * @param bakedHeights apron heights from the tile file, nullptr to sample the noise
+     */
+    static void generateChunk(ChunkData& data, const PerlinNoise& pn, const TerrainNoiseParams& params,
+                              float chunkSize, int chunkResolution, const float* bakedHeights);
+};
+
+#endif // TERRAINCHUNKS_HPP
@@ -0,0 +1,312 @@
+#include "TerrainClipmap.hpp"
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <omp.h>
+
+TerrainClipmap::TerrainClipmap()
+    : gridSize(129)
+    , halfSize(64)
+    , baseSpacing(25.0f)
+    , pn(-1)
+    , hasParams(false)
+    , levelsRegenerated(0)
+{
+    fullIndices.bufferID = 0;
+    fullIndices.count = 0;
+    for (int i = 0; i < 4; i++) {
+        ringIndices[i].bufferID = 0;
+        ringIndices[i].count = 0;
+    }
+}
+
+TerrainClipmap::~TerrainClipmap() {
+    cleanup();
+}
+
+void TerrainClipmap::initialize(int levelCount, int gridSize, float baseSpacing) {
+    if ((gridSize - 1) % 4 != 0) {
+        std::cerr << "[TerrainClipmap] gridSize - 1 must be a multiple of 4, got " << gridSize << std::endl;
+        gridSize = ((gridSize - 1) / 4) * 4 + 1;
+    }
+    this->gridSize = gridSize;
+    this->halfSize = (gridSize - 1) / 2;
+    this->baseSpacing = baseSpacing;
+
+    // Level 0 is a full grid
+    fullIndices = GridIndexCache::get(gridSize);
+
+    // The finer level sits either at the centre or one coarse cell further along +x/+z
+    for (int variant = 0; variant < 4; variant++) {
+        int offsetX = variant & 1;
+        int offsetZ = variant >> 1;
+        std::vector<unsigned int> indices = generateRingIndices(halfSize / 2 + offsetX, halfSize / 2 + offsetZ);
+        ringIndices[variant].count = static_cast<GLsizei>(indices.size());
+        glGenBuffers(1, &ringIndices[variant].bufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, ringIndices[variant].bufferID);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    const size_t vertexCount = gridSize * gridSize;
+    levels.resize(levelCount);
+    for (int l = 0; l < levelCount; l++) {
+        Level& level = levels[l];
+        level.spacing = baseSpacing * static_cast<float>(1 << l);
+        level.origin = glm::vec2(0.0f);
+        level.valid = false;
+        level.holeVariant = 0;
+        level.vertices.resize(vertexCount);
+        level.normals.resize(vertexCount);
+        level.morphHeights.resize(vertexCount);
+
+        glGenVertexArrays(1, &level.vertexArrayID);
+        glBindVertexArray(level.vertexArrayID);
+
+        glGenBuffers(1, &level.vertexBufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, level.vertexBufferID);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertexCount, NULL, GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(0);
+
+        glGenBuffers(1, &level.normalBufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, level.normalBufferID);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * vertexCount, NULL, GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(2);
+
+        glGenBuffers(1, &level.morphBufferID);
+        glBindBuffer(GL_ARRAY_BUFFER, level.morphBufferID);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * vertexCount, NULL, GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, 0, 0);
+        glEnableVertexAttribArray(3);
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, l == 0 ? fullIndices.bufferID : ringIndices[0].bufferID);
+
+        glBindVertexArray(0);
+    }
+
+    std::cout << "[TerrainClipmap] Initialized with " << levelCount << " levels of " << gridSize << "x" << gridSize
+              << ", coverage=" << getCoverage() << " world units" << std::endl;
+}
+
+float TerrainClipmap::getCoverage() const {
+    if (levels.empty()) return 0.0f;
+    return 2.0f * halfSize * levels.back().spacing;
+}
+
+void TerrainClipmap::setNoise(const PerlinNoise& pn, const TerrainNoiseParams& params) {
+    if (hasParams && params == this->params) return;
+
+    this->pn = pn;
+    this->params = params;
+    hasParams = true;
+    for (auto& level : levels) {
+        level.valid = false;
+    }
+}
+
+std::vector<unsigned int> TerrainClipmap::generateRingIndices(int holeStartX, int holeStartZ) const {
+    // Same strips as generate_grid_strip_indices, split around the quads the finer level covers
+    const unsigned int size = gridSize;
+    const int holeSize = halfSize;
+    const unsigned int holeRows = holeSize;
+    const unsigned int fullRows = size - 1 - holeRows;
+    std::vector<unsigned int> r;
+    // Full rows: one strip of 2 * size. Hole rows: two strips, 2 * (size + 1 - holeSize) indices in total
+    r.reserve(fullRows * 2 * size + holeRows * 2 * (size + 1 - holeSize) + (fullRows + 2 * holeRows - 1));
+    for (unsigned int i = 0; i <= size - 2; i++) {
+        bool holeRow = (int)i >= holeStartZ && (int)i < holeStartZ + holeSize;
+        // Runs of quads [start, end) in this row
+        unsigned int runs[2][2] = { { 0, size - 1 }, { 0, 0 } };
+        int runCount = 1;
+        if (holeRow) {
+            runs[0][1] = holeStartX;
+            runs[1][0] = holeStartX + holeSize;
+            runs[1][1] = size - 1;
+            runCount = 2;
+        }
+        for (int run = 0; run < runCount; run++) {
+            if (runs[run][0] == runs[run][1]) continue;
+            if (!r.empty()) {
+                r.push_back(GridIndexCache::RESTART_INDEX);
+            }
+            for (unsigned int j = runs[run][0]; j <= runs[run][1]; j++) {
+                r.push_back(i * size + j);
+                r.push_back(i * size + j + size);
+            }
+        }
+    }
+    return r;
+}
+
+bool TerrainClipmap::sampleHeight(float worldX, float worldZ, float& height) const {
+    for (const Level& level : levels) {
+        if (!level.valid) continue;
+        float gx = (worldX - level.origin.x) / level.spacing + halfSize;
+        float gz = (worldZ - level.origin.y) / level.spacing + halfSize;
+        const std::vector<glm::vec3>& vertices = level.vertices;
+        const int res = gridSize;
+        if (sampleGridBilinear([&vertices, res](int x, int z) { return vertices[x + z * res].y; },
+                               res, res, gx, gz, height)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+glm::vec2 TerrainClipmap::snapOrigin(const glm::vec3& cameraPos, float spacing) const {
+    // Snap to the next level's spacing so even vertices line up with the coarser grid
+    float snap = 2.0f * spacing;
+    return glm::vec2(std::floor(cameraPos.x / snap) * snap, std::floor(cameraPos.z / snap) * snap);
+}
+
+glm::mat4 TerrainClipmap::levelModelMatrix(const Level& level) const {
+    return glm::translate(glm::mat4(), glm::vec3(level.origin.x, 0.0f, level.origin.y));
+}
+
+void TerrainClipmap::generateLevel(Level& level) {
+    const int res = gridSize;
+    const int apronRes = res + 2;
+    const float spacing = level.spacing;
+    const float originX = level.origin.x - halfSize * spacing;
+    const float originZ = level.origin.y - halfSize * spacing;
+
+    // Heights including a one sample border for the edge normals
+    heightScratch.resize(apronRes * apronRes);
+    float* heights = &heightScratch[0];
+    const PerlinNoise& noise = pn;
+    const TerrainNoiseParams noiseParams = params;
+    #pragma omp parallel for
+    for (int z = 0; z < apronRes; z++) {
+        float worldZ = originZ + (z - 1) * spacing;
+        for (int x = 0; x < apronRes; x++) {
+            float worldX = originX + (x - 1) * spacing;
+            heights[x + z * apronRes] = terrainHeightAt(noise, noiseParams, worldX, worldZ);
+        }
+    }
+
+    #pragma omp parallel for
+    for (int z = 0; z < res; z++) {
+        for (int x = 0; x < res; x++) {
+            int a = (x + 1) + (z + 1) * apronRes;
+            float h = heights[a];
+            float hL = heights[a - 1];
+            float hR = heights[a + 1];
+            float hD = heights[a - apronRes];
+            float hU = heights[a + apronRes];
+
+            // Height of the coarser level here: even vertices are shared with it, odd ones lie on
+            // its edges, odd/odd ones lie on its quad diagonal (x, z + 1) - (x + 1, z)
+            bool oddX = (x & 1) != 0;
+            bool oddZ = (z & 1) != 0;
+            float morphHeight = h;
+            if (oddX && oddZ) morphHeight = 0.5f * (heights[a - 1 + apronRes] + heights[a + 1 - apronRes]);
+            else if (oddX) morphHeight = 0.5f * (hL + hR);
+            else if (oddZ) morphHeight = 0.5f * (hD + hU);
+
+            int i = x + z * res;
+            level.vertices[i] = glm::vec3((x - halfSize) * spacing, h, (z - halfSize) * spacing);
+            level.normals[i] = glm::normalize(glm::vec3(hL - hR, 2.0f * spacing, hD - hU));
+            level.morphHeights[i] = morphHeight;
+        }
+    }
+}
+
+void TerrainClipmap::uploadLevel(Level& level) {
+    const size_t vertexCount = level.vertices.size();
+    glBindBuffer(GL_ARRAY_BUFFER, level.vertexBufferID);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * vertexCount, &level.vertices[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, level.normalBufferID);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * vertexCount, &level.normals[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, level.morphBufferID);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * vertexCount, &level.morphHeights[0]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void TerrainClipmap::update(const glm::vec3& cameraPos) {
+    if (!hasParams) return;
+
+    levelsRegenerated = 0;
+    for (size_t l = 0; l < levels.size(); l++) {
+        Level& level = levels[l];
+        glm::vec2 origin = snapOrigin(cameraPos, level.spacing);
+        if (level.valid && origin == level.origin) continue;
+
+        level.origin = origin;
+        generateLevel(level);
+        uploadLevel(level);
+        level.valid = true;
+        levelsRegenerated++;
+    }
+
+    // Where the finer level sits inside each ring, in whole coarse cells (0 or 1 along each axis)
+    for (size_t l = 1; l < levels.size(); l++) {
+        glm::vec2 delta = (levels[l - 1].origin - levels[l].origin) / levels[l].spacing;
+        int offsetX = glm::clamp(static_cast<int>(std::floor(delta.x + 0.5f)), 0, 1);
+        int offsetZ = glm::clamp(static_cast<int>(std::floor(delta.y + 0.5f)), 0, 1);
+        levels[l].holeVariant = offsetX + 2 * offsetZ;
+    }
+}
+
+void TerrainClipmap::render(std::shared_ptr<Shader> shader, const glm::mat4& vp, const glm::vec3& cameraPos) {
+    shader->setUniVec3("cameraPos", cameraPos);
+    for (size_t l = 0; l < levels.size(); l++) {
+        const Level& level = levels[l];
+        if (!level.valid) continue;
+
+        glm::mat4 modelMatrix = levelModelMatrix(level);
+        shader->setUniMat4("MVP", vp * modelMatrix);
+        shader->setUniMat4("Model", modelMatrix);
+
+        // Fully morphed two cells before the edge (the camera can be up to 2 cells off the snapped centre),
+        // and unmorphed where the finer level ends
+        float extent = halfSize * level.spacing;
+        shader->setUniFloat("morphStart", 0.6f * extent);
+        shader->setUniFloat("morphEnd", extent - 2.0f * level.spacing);
+
+        glBindVertexArray(level.vertexArrayID);
+        if (l == 0) {
+            GridIndexCache::draw(fullIndices);
+        } else {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ringIndices[level.holeVariant].bufferID);
+            GridIndexCache::draw(ringIndices[level.holeVariant]);
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void TerrainClipmap::renderDepth(std::shared_ptr<Shader> depthShader) {
+    for (size_t l = 0; l < levels.size(); l++) {
+        const Level& level = levels[l];
+        if (!level.valid) continue;
+
+        depthShader->setUniMat4("Model", levelModelMatrix(level));
+
+        glBindVertexArray(level.vertexArrayID);
+        if (l == 0) {
+            GridIndexCache::draw(fullIndices);
+        } else {
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ringIndices[level.holeVariant].bufferID);
+            GridIndexCache::draw(ringIndices[level.holeVariant]);
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void TerrainClipmap::cleanup() {
+    for (auto& level : levels) {
+        glDeleteBuffers(1, &level.vertexBufferID);
+        glDeleteBuffers(1, &level.normalBufferID);
+        glDeleteBuffers(1, &level.morphBufferID);
+        glDeleteVertexArrays(1, &level.vertexArrayID);
+    }
+    levels.clear();
+    // The full grid's index buffer belongs to GridIndexCache
+    for (int i = 0; i < 4; i++) {
+        if (ringIndices[i].bufferID) {
+            glDeleteBuffers(1, &ringIndices[i].bufferID);
+            ringIndices[i].bufferID = 0;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef TERRAINCLIPMAP_HPP
+#define TERRAINCLIPMAP_HPP
+
+#include "GridIndexCache.hpp"
+#include "Perlin.hpp"
+#include "Shader.hpp"
+#include "TerrainParams.hpp"
+#include "utils.hpp"
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Geometry clipmap: nested square rings of the same grid, each level doubling the vertex spacing.
+ *
+ * - Every level is a gridSize x gridSize vertex grid centred on the camera, so the vertex budget is fixed
+ * - Level l is snapped to multiples of 2 * spacing(l), so its even vertices coincide with level l + 1
+ * - Level l > 0 skips the quads covered by level l - 1 (one of 4 shared ring index buffers, strips)
+ * - A level only regenerates its heights when its snapped origin moves or the noise changes
+ * - Each vertex also stores the height the next coarser level has at that spot, the vertex shader
+ *   morphs towards it near the level's outer edge so neighbouring levels meet without cracks or popping
+ *
+ * gridSize - 1 must be a multiple of 4.
+ */
+class TerrainClipmap {
+public:
+    TerrainClipmap();
+    ~TerrainClipmap();
+
+    TerrainClipmap(TerrainClipmap const&) = delete;
+    TerrainClipmap& operator=(TerrainClipmap const&) = delete;
+
+    /**
+     * @brief Create level buffers and the shared index buffers. Needs a GL context.
+     * @param levelCount number of nested levels
+     * @param gridSize vertices per level side
+     * @param baseSpacing vertex spacing of the finest level in world units
+     */
+    void initialize(int levelCount = 7, int gridSize = 129, float baseSpacing = 25.0f);
+
+    /**
+     * @brief Set the noise to sample, all levels regenerate if the parameters differ
+     */
+    void setNoise(const PerlinNoise& pn, const TerrainNoiseParams& params);
+
+    /**
+     * @brief Re-snap levels to the camera and regenerate the ones that moved
+     */
+    void update(const glm::vec3& cameraPos);
+
+    /**
+     * @brief Draw all levels. The shader must be the clipmap shader, in use, with its lighting uniforms set.
+     */
+    void render(std::shared_ptr<Shader> shader, const glm::mat4& vp, const glm::vec3& cameraPos);
+
+    /**
+     * @brief Draw all levels (unmorphed) with the shadow depth shader
+     */
+    void renderDepth(std::shared_ptr<Shader> depthShader);
+
+    void cleanup();
+
+    // Accessors for UI/debugging
+    int getLevelCount() const { return static_cast<int>(levels.size()); }
+    size_t getVertexCount() const { return levels.size() * gridSize * gridSize; }
+    int getLevelsRegenerated() const { return levelsRegenerated; }
+    float getCoverage() const;
+
+    /**
+     * @brief Bilinear height from the finest valid level covering a world position (unmorphed)
+     * @return false if no level covers it
+     */
+    bool sampleHeight(float worldX, float worldZ, float& height) const;
+
+private:
+    struct Level {
+        float spacing;
+        glm::vec2 origin;       // World XZ of the centre vertex, snapped to 2 * spacing
+        bool valid;
+        int holeVariant;        // Which ring index buffer to draw with (level > 0)
+
+        GLuint vertexArrayID;
+        GLuint vertexBufferID;
+        GLuint normalBufferID;
+        GLuint morphBufferID;
+
+        std::vector<glm::vec3> vertices;   // Local to origin
+        std::vector<glm::vec3> normals;
+        std::vector<float> morphHeights;  // Height of the next coarser level at each vertex
+    };
+
+    int gridSize;
+    int halfSize;
+    float baseSpacing;
+
+    PerlinNoise pn;
+    TerrainNoiseParams params;
+    bool hasParams;
+
+    std::vector<Level> levels;
+    std::vector<float> heightScratch;
+    int levelsRegenerated; // In the last update, for debugging
+
+    GridIndexBuffer fullIndices; // Shared, owned by GridIndexCache
+    // Ring index buffers (strips) for the 4 possible offsets of the finer level inside a coarser one
+    GridIndexBuffer ringIndices[4];
+
+    glm::vec2 snapOrigin(const glm::vec3& cameraPos, float spacing) const;
+    glm::mat4 levelModelMatrix(const Level& level) const;
+    std::vector<unsigned int> generateRingIndices(int holeStartX, int holeStartZ) const;
+    void generateLevel(Level& level);
+    void uploadLevel(Level& level);
+};
+
+#endif // TERRAINCLIPMAP_HPP
@@ -0,0 +1,118 @@
+#include "TerrainHeightRing.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <omp.h>
+
+TerrainHeightRing::TerrainHeightRing()
+    : resolution(0)
+    , originCell(0, 0)
+    , cellSize(0.0f)
+    , valid(false)
+    , fullRegeneration(false)
+{
+}
+
+void TerrainHeightRing::resize(int resolution) {
+    this->resolution = resolution;
+    heights.assign(resolution * resolution, 0.0f);
+    valid = false;
+}
+
+int TerrainHeightRing::scrollTo(glm::ivec2 newOriginCell, float newCellSize, const PerlinNoise& pn,
+                                const TerrainNoiseParams& newParams, bool force) {
+    dirtySlotRows.clear();
+    dirtySlotColumns.clear();
+    fullRegeneration = false;
+
+    glm::ivec2 delta = newOriginCell - originCell;
+    bool full = force || !valid || newCellSize != cellSize || newParams != params
+        || std::abs(delta.x) >= resolution || std::abs(delta.y) >= resolution;
+
+    glm::ivec2 oldMin = minCell();
+    originCell = newOriginCell;
+    cellSize = newCellSize;
+    params = newParams;
+
+    if (full) {
+        const glm::ivec2 newMin = minCell();
+        #pragma omp parallel
+        {
+            std::vector<float> row(resolution);
+            #pragma omp for
+            for (int z = 0; z < resolution; z++) {
+                int cellZ = newMin.y + z;
+                terrainHeightGrid(pn, params, newMin.x * cellSize, cellZ * cellSize, cellSize, resolution, 1, &row[0]);
+                writeRow(cellZ, &row[0]);
+            }
+        }
+        valid = true;
+        fullRegeneration = true;
+        return resolution * resolution;
+    }
+
+    const glm::ivec2 newMin = minCell();
+    int samples = 0;
+
+    // Columns that scrolled in along x (sampled over the whole new z range)
+    int firstCol = delta.x > 0 ? oldMin.x + resolution : newMin.x;
+    int lastCol = delta.x > 0 ? newMin.x + resolution : oldMin.x;
+    for (int cellX = firstCol; cellX < lastCol; cellX++) {
+        sampleColumn(cellX, pn);
+        dirtySlotColumns.push_back(wrap(cellX));
+        samples += resolution;
+    }
+
+    // Rows that scrolled in along z
+    int firstRow = delta.y > 0 ? oldMin.y + resolution : newMin.y;
+    int lastRow = delta.y > 0 ? newMin.y + resolution : oldMin.y;
+    for (int cellZ = firstRow; cellZ < lastRow; cellZ++) {
+        sampleRow(cellZ, pn);
+        dirtySlotRows.push_back(wrap(cellZ));
+        samples += resolution;
+    }
+
+    return samples;
+}
+
+void TerrainHeightRing::copyRow(int z, float* out) const {
+    // The row is rotated by the ring offset, so it is two contiguous pieces
+    const float* slotRow = &heights[slotZ(z) * resolution];
+    const int first = slotX(0);
+    std::memcpy(out, slotRow + first, sizeof(float) * (resolution - first));
+    std::memcpy(out + (resolution - first), slotRow, sizeof(float) * first);
+}
+
+bool TerrainHeightRing::sampleBilinear(float worldX, float worldZ, float& height) const {
+    if (!valid) return false;
+    glm::ivec2 corner = minCell();
+    float gx = worldX / cellSize - corner.x;
+    float gz = worldZ / cellSize - corner.y;
+    return sampleGridBilinear([this](int x, int z) { return at(x, z); }, resolution, resolution, gx, gz, height);
+}
+
+void TerrainHeightRing::writeRow(int cellZ, const float* row) {
+    // Inverse of copyRow
+    float* slotRow = &heights[wrap(cellZ) * resolution];
+    const int first = wrap(minCell().x);
+    std::memcpy(slotRow + first, row, sizeof(float) * (resolution - first));
+    std::memcpy(slotRow, row + (resolution - first), sizeof(float) * first);
+}
+
+void TerrainHeightRing::sampleColumn(int cellX, const PerlinNoise& pn) {
+    const int minZ = minCell().y;
+    const int slot = wrap(cellX);
+    std::vector<float> xs(resolution, cellX * cellSize), zs(resolution), column(resolution);
+    for (int z = 0; z < resolution; z++) {
+        zs[z] = (minZ + z) * cellSize;
+    }
+    terrainHeightsAt(pn, params, &xs[0], &zs[0], &column[0], resolution);
+    for (int z = 0; z < resolution; z++) {
+        heights[slot + wrap(minZ + z) * resolution] = column[z];
+    }
+}
+
+void TerrainHeightRing::sampleRow(int cellZ, const PerlinNoise& pn) {
+    std::vector<float> row(resolution);
+    terrainHeightGrid(pn, params, minCell().x * cellSize, cellZ * cellSize, cellSize, resolution, 1, &row[0]);
+    writeRow(cellZ, &row[0]);
+}
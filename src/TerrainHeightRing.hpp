@@ -0,0 +1,76 @@
+#ifndef TERRAINHEIGHTRING_HPP
+#define TERRAINHEIGHTRING_HPP
+
+#include "Perlin.hpp"
+#include "TerrainParams.hpp"
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Toroidal (wrap-around) heightfield for a camera-centred grid.
+ *
+ * Grid cells are snapped to whole world cells. A world cell (cx, cz) always lives in slot
+ * (cx mod resolution, cz mod resolution), so moving the grid by a few cells only overwrites
+ * the rows and columns that scrolled into view. Everything else is kept from the last frame.
+ *
+ * Logical coordinates (x, z) in [0, resolution) are relative to the grid's min corner, like the
+ * vertex grid in Terrain. Slot coordinates are where that sample sits in the ring.
+ */
+class TerrainHeightRing {
+public:
+    TerrainHeightRing();
+
+    void resize(int resolution);
+
+    /**
+     * @brief Move the grid so its centre vertex is world cell originCell, with cellSize world units per cell.
+     * Only newly exposed rows/columns are sampled, unless the cell size or noise changed (or force is set).
+     * @return number of height samples computed
+     */
+    int scrollTo(glm::ivec2 originCell, float cellSize, const PerlinNoise& pn, const TerrainNoiseParams& params,
+                 bool force = false);
+
+    // Height at logical grid coordinates
+    float at(int x, int z) const { return heights[slotX(x) + slotZ(z) * resolution]; }
+    // Logical row z in x order, resolution floats
+    void copyRow(int z, float* out) const;
+    // Bilinear height at a world position, false if the grid does not cover it (or was never sampled)
+    bool sampleBilinear(float worldX, float worldZ, float& height) const;
+
+    int getResolution() const { return resolution; }
+    glm::ivec2 getOriginCell() const { return originCell; }
+    float getCellSize() const { return cellSize; }
+    // Slot of logical (0, 0)
+    glm::ivec2 getRingOffset() const { return glm::ivec2(slotX(0), slotZ(0)); }
+    const std::vector<float>& getHeights() const { return heights; }
+
+    // Slot rows/columns rewritten by the last scrollTo, for partial GPU updates
+    bool wasFullyRegenerated() const { return fullRegeneration; }
+    const std::vector<int>& getDirtySlotRows() const { return dirtySlotRows; }
+    const std::vector<int>& getDirtySlotColumns() const { return dirtySlotColumns; }
+
+private:
+    int resolution;
+    glm::ivec2 originCell;
+    float cellSize;
+    TerrainNoiseParams params;
+    bool valid;
+
+    std::vector<float> heights; // resolution^2, slot order
+    bool fullRegeneration;
+    std::vector<int> dirtySlotRows;
+    std::vector<int> dirtySlotColumns;
+
+    int wrap(int i) const { int m = i % resolution; return m < 0 ? m + resolution : m; }
+    // World cell of logical (0, 0)
+    glm::ivec2 minCell() const { return originCell - glm::ivec2(resolution / 2, resolution / 2); }
+    int slotX(int x) const { return wrap(minCell().x + x); }
+    int slotZ(int z) const { return wrap(minCell().y + z); }
+
+    // Logical row (x order) into the slots of world row cellZ
+    void writeRow(int cellZ, const float* row);
+    void sampleColumn(int cellX, const PerlinNoise& pn);
+    void sampleRow(int cellZ, const PerlinNoise& pn);
+};
+
+#endif // TERRAINHEIGHTRING_HPP
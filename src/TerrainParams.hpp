@@ -0,0 +1,114 @@
+#ifndef TERRAINPARAMS_HPP
+#define TERRAINPARAMS_HPP
+
+#include "Perlin.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Snapshot of everything that decides the terrain height at a world position.
+// Passed by value to background jobs so they never read Terrain's live members.
+struct TerrainNoiseParams {
+    int octaves;
+    float persistence;
+    float lacunarity;
+    float peakHeight;
+    float horizontalScale; // world units per unit of noise space (Terrain::scale.x)
+    unsigned int seed;     // PerlinNoise permutation seed, carried so a reseed counts as a change
+    NoiseBasis basis;
+    OctaveSchedule schedule; // Derived from the octave fields and horizontalScale, see updateSchedule()
+
+    TerrainNoiseParams()
+        : octaves(5),
+          persistence(0.503f),
+          lacunarity(2.0f),
+          peakHeight(1100.0f),
+          horizontalScale(3000.0f),
+          seed(0),
+          basis(NoiseBasis::Perlin) {
+        updateSchedule();
+    }
+
+    // Call after changing octaves, persistence, lacunarity or horizontalScale
+    void updateSchedule() {
+        schedule = OctaveSchedule(octaves, persistence, lacunarity, 1.0f / horizontalScale);
+    }
+
+    // schedule is derived, comparing its inputs is enough
+    bool operator==(const TerrainNoiseParams& other) const {
+        return octaves == other.octaves
+            && persistence == other.persistence
+            && lacunarity == other.lacunarity
+            && peakHeight == other.peakHeight
+            && horizontalScale == other.horizontalScale
+            && seed == other.seed
+            && basis == other.basis;
+    }
+    bool operator!=(const TerrainNoiseParams& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Terrain height at a world position. Same mapping as the rendered grid:
+ * noise is sampled at world / horizontalScale and remapped from [0,1] to [-peakHeight, peakHeight].
+ */
+inline float terrainHeightAt(const PerlinNoise& pn, const TerrainNoiseParams& params, float worldX, float worldZ) {
+    float h = pn.octavePerlin(worldX, worldZ, params.schedule);
+    return params.peakHeight * (h - 0.5f) * 2.0f;
+}
+
+/**
+ * @brief terrainHeightAt for count positions at once, through the SIMD batch noise
+ */
+inline void terrainHeightsAt(const PerlinNoise& pn, const TerrainNoiseParams& params,
+                             const float* worldXs, const float* worldZs, float* out, int count) {
+    pn.octavePerlinBatch(worldXs, worldZs, out, count, params.schedule);
+    for (int i = 0; i < count; i++) {
+        out[i] = params.peakHeight * (out[i] - 0.5f) * 2.0f;
+    }
+}
+
+/**
+ * @brief terrainHeightAt over a regular grid starting at (worldX0, worldZ0), row-coherent noise walk.
+ * out[c + r * width] is the height at (worldX0 + c * spacing, worldZ0 + r * spacing).
+ */
+inline void terrainHeightGrid(const PerlinNoise& pn, const TerrainNoiseParams& params, float worldX0, float worldZ0,
+                              float spacing, int width, int height, float* out) {
+    pn.octavePerlinGrid(worldX0, worldZ0, spacing, width, height, out, params.schedule);
+    for (int i = 0; i < width * height; i++) {
+        out[i] = params.peakHeight * (out[i] - 0.5f) * 2.0f;
+    }
+}
+
+/**
+ * @brief terrainHeightAt plus its world-space gradient, from one octave pass with analytic derivatives.
+ * @return (height, d height/d worldX, d height/d worldZ)
+ */
+inline glm::vec3 terrainHeightAndGradientAt(const PerlinNoise& pn, const TerrainNoiseParams& params,
+                                            float worldX, float worldZ) {
+    // The schedule's frequencies include 1 / horizontalScale, so the gradient is already per world unit
+    glm::vec3 h = pn.octavePerlinWithDerivatives(worldX, worldZ, params.schedule);
+    float gradientScale = params.peakHeight * 2.0f;
+    return glm::vec3(params.peakHeight * (h.x - 0.5f) * 2.0f, h.y * gradientScale, h.z * gradientScale);
+}
+
+/**
+ * @brief Bilinear height at fractional grid coordinates (gx, gz) of a width x height vertex grid.
+ * heightAt(x, z) returns the vertex height, so any storage order (or a toroidal ring) works.
+ * @return false if (gx, gz) is outside the grid, height is left untouched
+ */
+template <typename HeightAt>
+inline bool sampleGridBilinear(HeightAt heightAt, int width, int height, float gx, float gz, float& out) {
+    if (!(gx >= 0.0f && gz >= 0.0f && gx <= width - 1 && gz <= height - 1) || width < 2 || height < 2) {
+        return false;
+    }
+    // The last row/column interpolates inside the cell before it
+    int x0 = std::min(static_cast<int>(gx), width - 2);
+    int z0 = std::min(static_cast<int>(gz), height - 2);
+    float fx = gx - x0;
+    float fz = gz - z0;
+    float h0 = heightAt(x0, z0) + (heightAt(x0 + 1, z0) - heightAt(x0, z0)) * fx;
+    float h1 = heightAt(x0, z0 + 1) + (heightAt(x0 + 1, z0 + 1) - heightAt(x0, z0 + 1)) * fx;
+    out = h0 + (h1 - h0) * fz;
+    return true;
+}
+
+#endif // TERRAINPARAMS_HPP
@@ -0,0 +1,207 @@
+#include "TerrainTiles.hpp"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <omp.h>
+
+namespace {
+
+const char TILE_FILE_MAGIC[4] = {'W', 'T', 'I', 'L'};
+const uint32_t TILE_FILE_VERSION = 1;
+
+// Everything is 4 bytes wide, so there is no padding to worry about
+struct TileFileHeader {
+    char magic[4];
+    uint32_t version;
+    int32_t octaves;
+    float persistence;
+    float lacunarity;
+    float peakHeight;
+    float horizontalScale;
+    uint32_t seed;
+    int32_t basis;
+    float tileSize;
+    int32_t tileResolution;
+    uint32_t tileCount;
+};
+
+struct TileIndexEntry {
+    int32_t x;
+    int32_t z;
+    uint64_t offset;
+};
+
+static_assert(sizeof(TileFileHeader) == 48, "TileFileHeader must not be padded");
+static_assert(sizeof(TileIndexEntry) == 16, "TileIndexEntry must not be padded");
+
+size_t apronSampleCount(int tileResolution) {
+    return static_cast<size_t>(tileResolution + 2) * (tileResolution + 2);
+}
+
+} // namespace
+
+void terrainTileHeights(const PerlinNoise& pn, const TerrainNoiseParams& params, glm::ivec2 coord,
+                        float tileSize, int tileResolution, float* out) {
+    const int apronRes = tileResolution + 2;
+    const float spacing = tileSize / static_cast<float>(tileResolution - 1);
+    const float originX = coord.x * tileSize;
+    const float originZ = coord.y * tileSize;
+    terrainHeightGrid(pn, params, originX - spacing, originZ - spacing, spacing, apronRes, apronRes, out);
+}
+
+TerrainTileFile::TerrainTileFile()
+    : tileSize(0.0f)
+    , tileResolution(0)
+{
+}
+
+TerrainTileFile::~TerrainTileFile() {
+    close();
+}
+
+int64_t TerrainTileFile::tileKey(int tileX, int tileZ) {
+    return static_cast<int64_t>(tileX) + static_cast<int64_t>(tileZ) * 1000003LL;
+}
+
+bool TerrainTileFile::bake(const std::string& path, const PerlinNoise& pn, const TerrainNoiseParams& params,
+                           float tileSize, int tileResolution, glm::ivec2 minTile, glm::ivec2 maxTile) {
+    if (tileResolution < 2 || maxTile.x < minTile.x || maxTile.y < minTile.y) {
+        std::cerr << "[TerrainTileFile] Nothing to bake for " << path << std::endl;
+        return false;
+    }
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "[TerrainTileFile] Could not open " << path << " for writing" << std::endl;
+        return false;
+    }
+
+    const int tilesX = maxTile.x - minTile.x + 1;
+    const int tilesZ = maxTile.y - minTile.y + 1;
+    const size_t samplesPerTile = apronSampleCount(tileResolution);
+    const size_t tileBytes = sizeof(float) * samplesPerTile;
+
+    TileFileHeader header;
+    std::memcpy(header.magic, TILE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TILE_FILE_VERSION;
+    header.octaves = params.octaves;
+    header.persistence = params.persistence;
+    header.lacunarity = params.lacunarity;
+    header.peakHeight = params.peakHeight;
+    header.horizontalScale = params.horizontalScale;
+    header.seed = params.seed;
+    header.basis = static_cast<int32_t>(params.basis);
+    header.tileSize = tileSize;
+    header.tileResolution = tileResolution;
+    header.tileCount = static_cast<uint32_t>(tilesX * tilesZ);
+
+    // Tiles are stored in index order right after the index
+    std::vector<TileIndexEntry> index(header.tileCount);
+    uint64_t offset = sizeof(TileFileHeader) + sizeof(TileIndexEntry) * index.size();
+    for (int z = 0; z < tilesZ; z++) {
+        for (int x = 0; x < tilesX; x++) {
+            TileIndexEntry& entry = index[x + z * tilesX];
+            entry.x = minTile.x + x;
+            entry.z = minTile.y + z;
+            entry.offset = offset;
+            offset += tileBytes;
+        }
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(index.data(), sizeof(TileIndexEntry), index.size(), file) == index.size();
+
+    // One row of tiles at a time, so memory stays bounded for large worlds
+    std::vector<float> row(samplesPerTile * tilesX);
+    for (int z = 0; z < tilesZ && ok; z++) {
+        #pragma omp parallel for
+        for (int x = 0; x < tilesX; x++) {
+            terrainTileHeights(pn, params, glm::ivec2(minTile.x + x, minTile.y + z), tileSize, tileResolution,
+                               &row[samplesPerTile * x]);
+        }
+        ok = std::fwrite(row.data(), sizeof(float), row.size(), file) == row.size();
+    }
+    ok = std::fclose(file) == 0 && ok;
+
+    if (!ok) {
+        std::cerr << "[TerrainTileFile] Failed writing " << path << std::endl;
+        std::remove(path.c_str());
+        return false;
+    }
+    std::cout << "[TerrainTileFile] Baked " << header.tileCount << " tiles (" << tilesX << "x" << tilesZ
+              << ", " << tileBytes << " bytes each) into " << path << std::endl;
+    return true;
+}
+
+bool TerrainTileFile::open(const std::string& path) {
+    close();
+    if (!file.open(path)) return false;
+    const unsigned char* data = file.data();
+    const size_t size = file.size();
+
+    TileFileHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "[TerrainTileFile] " << path << " is too small for a tile file" << std::endl;
+        close();
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, TILE_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != TILE_FILE_VERSION) {
+        std::cerr << "[TerrainTileFile] " << path << " is not a version " << TILE_FILE_VERSION << " tile file" << std::endl;
+        close();
+        return false;
+    }
+
+    const size_t tileBytes = sizeof(float) * apronSampleCount(header.tileResolution);
+    const size_t indexEnd = sizeof(header) + sizeof(TileIndexEntry) * static_cast<size_t>(header.tileCount);
+    if (header.tileResolution < 2 || size < indexEnd) {
+        std::cerr << "[TerrainTileFile] " << path << " has a truncated index" << std::endl;
+        close();
+        return false;
+    }
+
+    params.octaves = header.octaves;
+    params.persistence = header.persistence;
+    params.lacunarity = header.lacunarity;
+    params.peakHeight = header.peakHeight;
+    params.horizontalScale = header.horizontalScale;
+    params.seed = header.seed;
+    params.basis = static_cast<NoiseBasis>(header.basis);
+    params.updateSchedule();
+    tileSize = header.tileSize;
+    tileResolution = header.tileResolution;
+
+    tileOffsets.reserve(header.tileCount);
+    for (uint32_t i = 0; i < header.tileCount; i++) {
+        TileIndexEntry entry;
+        std::memcpy(&entry, data + sizeof(header) + sizeof(entry) * i, sizeof(entry));
+        // Heights are read in place, so they must be float aligned and inside the file
+        if (entry.offset % sizeof(float) != 0 || entry.offset < indexEnd || entry.offset + tileBytes > size) {
+            std::cerr << "[TerrainTileFile] " << path << " has a tile outside the file" << std::endl;
+            close();
+            return false;
+        }
+        tileOffsets[tileKey(entry.x, entry.z)] = entry.offset;
+    }
+
+    std::cout << "[TerrainTileFile] Mapped " << tileOffsets.size() << " tiles (" << size << " bytes) from "
+              << path << std::endl;
+    return true;
+}
+
+void TerrainTileFile::close() {
+    file.close();
+    tileOffsets.clear();
+    tileSize = 0.0f;
+    tileResolution = 0;
+}
+
+bool TerrainTileFile::matches(const TerrainNoiseParams& params, float tileSize, int tileResolution) const {
+    return isOpen() && params == this->params && tileSize == this->tileSize && tileResolution == this->tileResolution;
+}
+
+const float* TerrainTileFile::findTile(int tileX, int tileZ) const {
+    auto it = tileOffsets.find(tileKey(tileX, tileZ));
+    if (it == tileOffsets.end()) return nullptr;
+    return reinterpret_cast<const float*>(file.data() + it->second);
+}
@@ -0,0 +1,81 @@
+#ifndef TERRAINTILES_HPP
+#define TERRAINTILES_HPP
+
+#include "MappedFile.hpp"
+#include "Perlin.hpp"
+#include "TerrainParams.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Heights of one world-space tile (a chunk in TerrainChunkManager) with a one sample apron.
+ * The tile at coord covers [coord * tileSize, (coord + 1) * tileSize] with tileResolution vertices per side;
+ * out holds (tileResolution + 2)^2 heights, row-major, starting one spacing before the tile origin.
+ * Used by both the chunk workers and the offline bake, so baked and generated tiles are identical.
+ */
+void terrainTileHeights(const PerlinNoise& pn, const TerrainNoiseParams& params, glm::ivec2 coord,
+                        float tileSize, int tileResolution, float* out);
+
+/**
+ * @brief Read-only, memory-mapped file of pre-baked terrain tiles.
+ *
+ * Layout (little endian):
+ * - Header: magic, version, the noise parameters it was baked with, tile size/resolution, tile count
+ * - Index: (x, z, byte offset) per tile
+ * - Data: (tileResolution + 2)^2 floats per tile, see terrainTileHeights()
+ *
+ * Only the header and index are read on open, tile heights are paged in by the OS on first access.
+ * Tiles are immutable once mapped, so worker threads can read them without locking.
+ */
+class TerrainTileFile {
+public:
+    TerrainTileFile();
+    ~TerrainTileFile();
+
+    TerrainTileFile(TerrainTileFile const&) = delete;
+    TerrainTileFile& operator=(TerrainTileFile const&) = delete;
+
+    /**
+     * @brief Bake every tile in [minTile, maxTile] (inclusive) into path, tiles are generated in parallel
+     * @return false if the file could not be written
+     */
+    static bool bake(const std::string& path, const PerlinNoise& pn, const TerrainNoiseParams& params,
+                     float tileSize, int tileResolution, glm::ivec2 minTile, glm::ivec2 maxTile);
+
+    /**
+     * @brief Map a baked file. Replaces any file mapped before.
+     * @return false if the file is missing, truncated or from another version
+     */
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return file.isOpen(); }
+
+    /**
+     * @brief Whether the tiles were baked with exactly these noise parameters and tile layout
+     */
+    bool matches(const TerrainNoiseParams& params, float tileSize, int tileResolution) const;
+
+    /**
+     * @brief Apron heights of a tile (see terrainTileHeights), or nullptr if it was not baked
+     */
+    const float* findTile(int tileX, int tileZ) const;
+
+    size_t getTileCount() const { return tileOffsets.size(); }
+    float getTileSize() const { return tileSize; }
+    int getTileResolution() const { return tileResolution; }
+
+private:
+    MappedFile file;
+
+    TerrainNoiseParams params;
+    float tileSize;
+    int tileResolution;
+    std::unordered_map<int64_t, uint64_t> tileOffsets; // Tile key -> byte offset of its heights
+
+    static int64_t tileKey(int tileX, int tileZ);
+};
+
+#endif // TERRAINTILES_HPP
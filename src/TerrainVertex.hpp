@@ -0,0 +1,50 @@
+#ifndef TERRAINVERTEX_HPP
+#define TERRAINVERTEX_HPP
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/**
+ * @brief Compact vertex for the streamed Grid terrain, 6 bytes instead of 24 (two vec3 buffers).
+ *
+ * Grid x/z are implied by gl_VertexID, so only the height and the normal are stored, interleaved:
+ * - height: snorm16 of height / heightScale
+ * - normal: octahedral-encoded unit normal, 2 x snorm16 (the y axis is the fold axis, terrain is mostly y-up)
+ *
+ * terrain.vert decodes it with heightSource 3.
+ */
+struct PackedTerrainVertex {
+    int16_t height;
+    int16_t normal[2];
+};
+static_assert(sizeof(PackedTerrainVertex) == 6, "PackedTerrainVertex must stay tightly packed");
+
+inline int16_t packSnorm16(float v) {
+    v = glm::clamp(v, -1.0f, 1.0f);
+    return static_cast<int16_t>(v * 32767.0f + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+/**
+ * @brief Octahedral encoding of a direction (any length), folded around y. Matches octahedralDecode in terrain.vert.
+ */
+inline glm::vec2 octahedralEncode(glm::vec3 n) {
+    n /= (glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z));
+    glm::vec2 e(n.x, n.z);
+    if (n.y < 0.0f) {
+        e = glm::vec2((1.0f - glm::abs(n.z)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - glm::abs(n.x)) * (n.z >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+// normal does not need to be unit length, the encoding normalises it
+inline PackedTerrainVertex packTerrainVertex(float height, float heightScale, glm::vec3 normal) {
+    PackedTerrainVertex v;
+    v.height = packSnorm16(height / heightScale);
+    glm::vec2 e = octahedralEncode(normal);
+    v.normal[0] = packSnorm16(e.x);
+    v.normal[1] = packSnorm16(e.y);
+    return v;
+}
+
+#endif // TERRAINVERTEX_HPP
@@ -0,0 +1,684 @@
+#include "CookedModel.hpp"
+#include "MappedFile.hpp"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+
+namespace {
+
+const char COOKED_MAGIC[4] = {'W', 'M', 'D', 'L'};
+const size_t DATA_ALIGNMENT = 16;
+
+struct CookedHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t metadataSize;  // Bytes of metadata right after the header
+    uint64_t dataOffset;    // File offset of the first buffer, buffer offsets are relative to it
+};
+static_assert(sizeof(CookedHeader) == 24, "CookedHeader must have no padding");
+
+size_t alignUp(size_t value) {
+    return (value + DATA_ALIGNMENT - 1) & ~(DATA_ALIGNMENT - 1);
+}
+
+// Appends plain values to the metadata blob
+class BlobWriter {
+    public:
+        std::vector<unsigned char> bytes;
+
+        void raw(const void* data, size_t size) {
+            const unsigned char* p = static_cast<const unsigned char*>(data);
+            bytes.insert(bytes.end(), p, p + size);
+        }
+        void u32(uint32_t v) { raw(&v, sizeof(v)); }
+        void i32(int32_t v) { raw(&v, sizeof(v)); }
+        void u64(uint64_t v) { raw(&v, sizeof(v)); }
+        void f64(double v) { raw(&v, sizeof(v)); }
+        void count(size_t n) { u32(static_cast<uint32_t>(n)); }
+        void str(const std::string& s) {
+            count(s.size());
+            raw(s.data(), s.size());
+        }
+        void ints(const std::vector<int>& values) {
+            count(values.size());
+            for (int v : values) i32(v);
+        }
+        void doubles(const std::vector<double>& values) {
+            count(values.size());
+            for (double v : values) f64(v);
+        }
+        void attributes(const std::map<std::string, int>& values) {
+            count(values.size());
+            for (const auto& kv : values) {
+                str(kv.first);
+                i32(kv.second);
+            }
+        }
+        void texture(int index, int texCoord) {
+            i32(index);
+            i32(texCoord);
+        }
+};
+
+// Reads values back from the mapped metadata. Every read is bounds checked: once the blob runs out
+// ok is false and all further reads return zero/empty, so a truncated file fails cleanly.
+class BlobReader {
+    public:
+        bool ok;
+
+        BlobReader(const unsigned char* begin, const unsigned char* end) : ok(true), p(begin), end(end) {}
+
+        bool raw(void* out, size_t size) {
+            if (!ok || static_cast<size_t>(end - p) < size) {
+                ok = false;
+                std::memset(out, 0, size);
+                return false;
+            }
+            std::memcpy(out, p, size);
+            p += size;
+            return true;
+        }
+        uint32_t u32() { uint32_t v; raw(&v, sizeof(v)); return v; }
+        int32_t i32() { int32_t v; raw(&v, sizeof(v)); return v; }
+        uint64_t u64() { uint64_t v; raw(&v, sizeof(v)); return v; }
+        double f64() { double v; raw(&v, sizeof(v)); return v; }
+        // Element counts can't exceed the bytes left (every element is at least one byte),
+        // which keeps a corrupt count from triggering a huge allocation
+        size_t count() {
+            uint32_t n = u32();
+            if (n > static_cast<size_t>(end - p)) {
+                ok = false;
+                return 0;
+            }
+            return n;
+        }
+        std::string str() {
+            size_t n = count();
+            std::string s(reinterpret_cast<const char*>(p), ok ? n : 0);
+            if (ok) p += n;
+            return s;
+        }
+        std::vector<int> ints() {
+            std::vector<int> values(count());
+            for (int& v : values) v = i32();
+            return values;
+        }
+        std::vector<double> doubles() {
+            std::vector<double> values(count());
+            for (double& v : values) v = f64();
+            return values;
+        }
+        std::map<std::string, int> attributes() {
+            std::map<std::string, int> values;
+            size_t n = count();
+            for (size_t i = 0; i < n && ok; i++) {
+                std::string name = str();
+                values[name] = i32();
+            }
+            return values;
+        }
+        template <typename Info>
+        void texture(Info& info) {
+            info.index = i32();
+            info.texCoord = i32();
+        }
+
+    private:
+        const unsigned char* p;
+        const unsigned char* end;
+};
+
+// Bytes of one accessor element, 0 for an unknown component or element type
+uint64_t elementBytes(const tinygltf::Accessor& accessor) {
+    uint64_t component;
+    switch (accessor.componentType) {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: component = 1; break;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: component = 2; break;
+        case TINYGLTF_COMPONENT_TYPE_INT:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: component = 4; break;
+        default: return 0;
+    }
+    switch (accessor.type) {
+        case TINYGLTF_TYPE_SCALAR: return component;
+        case TINYGLTF_TYPE_VEC2: return 2 * component;
+        case TINYGLTF_TYPE_VEC3: return 3 * component;
+        case TINYGLTF_TYPE_VEC4:
+        case TINYGLTF_TYPE_MAT2: return 4 * component;
+        case TINYGLTF_TYPE_MAT3: return 9 * component;
+        case TINYGLTF_TYPE_MAT4: return 16 * component;
+        default: return 0;
+    }
+}
+
+bool inRange(int index, size_t size) {
+    return index >= 0 && static_cast<size_t>(index) < size;
+}
+
+// -1 means "none" for optional references
+bool inRangeOrNone(int index, size_t size) {
+    return index == -1 || inRange(index, size);
+}
+
+bool allInRange(const std::vector<int>& indices, size_t size) {
+    for (int index : indices) {
+        if (!inRange(index, size)) return false;
+    }
+    return true;
+}
+
+// Checks every reference and byte range of a freshly read model, so the loaders can index buffers
+// and arrays with them unchecked. Returns what is wrong, or an empty string.
+std::string checkReferences(const tinygltf::Model& model) {
+    for (size_t i = 0; i < model.bufferViews.size(); i++) {
+        const tinygltf::BufferView& view = model.bufferViews[i];
+        if (!inRange(view.buffer, model.buffers.size())) {
+            return "buffer view " + std::to_string(i) + " refers to a missing buffer";
+        }
+        uint64_t bufferSize = model.buffers[view.buffer].data.size();
+        if (view.byteOffset > bufferSize || view.byteLength > bufferSize - view.byteOffset) {
+            return "buffer view " + std::to_string(i) + " is outside its buffer";
+        }
+    }
+
+    for (size_t i = 0; i < model.accessors.size(); i++) {
+        const tinygltf::Accessor& accessor = model.accessors[i];
+        if (!inRange(accessor.bufferView, model.bufferViews.size())) {
+            return "accessor " + std::to_string(i) + " refers to a missing buffer view";
+        }
+        const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+        uint64_t element = elementBytes(accessor);
+        uint64_t stride = view.byteStride != 0 ? view.byteStride : element;
+        if (element == 0 || stride < element) {
+            return "accessor " + std::to_string(i) + " has an invalid type or stride";
+        }
+        // Last element ends at byteOffset + (count - 1) * stride + element, written to not overflow
+        if (accessor.count > 0 &&
+            (accessor.byteOffset > view.byteLength || element > view.byteLength - accessor.byteOffset ||
+             accessor.count - 1 > (view.byteLength - accessor.byteOffset - element) / stride)) {
+            return "accessor " + std::to_string(i) + " reads past its buffer view";
+        }
+    }
+
+    for (size_t i = 0; i < model.meshes.size(); i++) {
+        for (const tinygltf::Primitive& primitive : model.meshes[i].primitives) {
+            bool ok = inRangeOrNone(primitive.indices, model.accessors.size())
+                && inRangeOrNone(primitive.material, model.materials.size());
+            for (const auto& attrib : primitive.attributes) ok = ok && inRange(attrib.second, model.accessors.size());
+            for (const auto& target : primitive.targets) {
+                for (const auto& attrib : target) ok = ok && inRange(attrib.second, model.accessors.size());
+            }
+            if (!ok) return "mesh " + std::to_string(i) + " refers to a missing accessor or material";
+        }
+    }
+
+    for (size_t i = 0; i < model.materials.size(); i++) {
+        const tinygltf::Material& material = model.materials[i];
+        size_t textures = model.textures.size();
+        if (!inRangeOrNone(material.pbrMetallicRoughness.baseColorTexture.index, textures) ||
+            !inRangeOrNone(material.pbrMetallicRoughness.metallicRoughnessTexture.index, textures) ||
+            !inRangeOrNone(material.normalTexture.index, textures) ||
+            !inRangeOrNone(material.occlusionTexture.index, textures) ||
+            !inRangeOrNone(material.emissiveTexture.index, textures)) {
+            return "material " + std::to_string(i) + " refers to a missing texture";
+        }
+    }
+
+    for (size_t i = 0; i < model.nodes.size(); i++) {
+        const tinygltf::Node& node = model.nodes[i];
+        if (!inRangeOrNone(node.mesh, model.meshes.size()) || !inRangeOrNone(node.skin, model.skins.size()) ||
+            !allInRange(node.children, model.nodes.size())) {
+            return "node " + std::to_string(i) + " refers to a missing mesh, skin or child";
+        }
+    }
+
+    for (size_t i = 0; i < model.skins.size(); i++) {
+        const tinygltf::Skin& skin = model.skins[i];
+        if (!inRangeOrNone(skin.inverseBindMatrices, model.accessors.size()) ||
+            !inRangeOrNone(skin.skeleton, model.nodes.size()) || !allInRange(skin.joints, model.nodes.size())) {
+            return "skin " + std::to_string(i) + " refers to a missing accessor or node";
+        }
+    }
+
+    for (size_t i = 0; i < model.animations.size(); i++) {
+        const tinygltf::Animation& animation = model.animations[i];
+        bool ok = true;
+        for (const tinygltf::AnimationChannel& channel : animation.channels) {
+            ok = ok && inRange(channel.sampler, animation.samplers.size())
+                && inRangeOrNone(channel.target_node, model.nodes.size());
+        }
+        for (const tinygltf::AnimationSampler& sampler : animation.samplers) {
+            ok = ok && inRange(sampler.input, model.accessors.size()) && inRange(sampler.output, model.accessors.size());
+        }
+        if (!ok) return "animation " + std::to_string(i) + " refers to a missing sampler, node or accessor";
+    }
+
+    for (size_t i = 0; i < model.textures.size(); i++) {
+        const tinygltf::Texture& texture = model.textures[i];
+        if (!inRangeOrNone(texture.source, model.images.size()) ||
+            !inRangeOrNone(texture.sampler, model.samplers.size())) {
+            return "texture " + std::to_string(i) + " refers to a missing image or sampler";
+        }
+    }
+    for (size_t i = 0; i < model.images.size(); i++) {
+        if (!inRangeOrNone(model.images[i].bufferView, model.bufferViews.size())) {
+            return "image " + std::to_string(i) + " refers to a missing buffer view";
+        }
+    }
+
+    for (size_t i = 0; i < model.scenes.size(); i++) {
+        if (!allInRange(model.scenes[i].nodes, model.nodes.size())) {
+            return "scene " + std::to_string(i) + " refers to a missing node";
+        }
+    }
+    if (!inRangeOrNone(model.defaultScene, model.scenes.size())) return "the default scene is missing";
+    return std::string();
+}
+
+}
+
+std::string CookedModel::pathFor(const std::string& gltfPath) {
+    size_t slash = gltfPath.find_last_of("/\\");
+    size_t dot = gltfPath.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return gltfPath + ".cooked";
+    return gltfPath.substr(0, dot) + ".cooked";
+}
+
+bool CookedModel::write(const tinygltf::Model& model, const std::string& path, std::string& err) {
+    BlobWriter meta;
+
+    meta.str(model.asset.version);
+    meta.str(model.asset.generator);
+    meta.i32(model.defaultScene);
+
+    // Buffers: only sizes and offsets here, the bytes go into the data section
+    std::vector<uint64_t> bufferOffsets;
+    uint64_t dataSize = 0;
+    meta.count(model.buffers.size());
+    for (const tinygltf::Buffer& buffer : model.buffers) {
+        bufferOffsets.push_back(dataSize);
+        meta.str(buffer.name);
+        meta.u64(dataSize);
+        meta.u64(buffer.data.size());
+        dataSize = alignUp(dataSize + buffer.data.size());
+    }
+
+    meta.count(model.bufferViews.size());
+    for (const tinygltf::BufferView& view : model.bufferViews) {
+        meta.str(view.name);
+        meta.i32(view.buffer);
+        meta.u64(view.byteOffset);
+        meta.u64(view.byteLength);
+        meta.u64(view.byteStride);
+        meta.i32(view.target);
+    }
+
+    meta.count(model.accessors.size());
+    for (size_t i = 0; i < model.accessors.size(); i++) {
+        const tinygltf::Accessor& accessor = model.accessors[i];
+        if (accessor.sparse.isSparse) {
+            err = "accessor " + std::to_string(i) + " is sparse, which cooked models do not support";
+            return false;
+        }
+        meta.str(accessor.name);
+        meta.i32(accessor.bufferView);
+        meta.u64(accessor.byteOffset);
+        meta.u32(accessor.normalized ? 1 : 0);
+        meta.i32(accessor.componentType);
+        meta.u64(accessor.count);
+        meta.i32(accessor.type);
+        meta.doubles(accessor.minValues);
+        meta.doubles(accessor.maxValues);
+    }
+
+    meta.count(model.meshes.size());
+    for (const tinygltf::Mesh& mesh : model.meshes) {
+        meta.str(mesh.name);
+        meta.doubles(mesh.weights);
+        meta.count(mesh.primitives.size());
+        for (const tinygltf::Primitive& primitive : mesh.primitives) {
+            meta.attributes(primitive.attributes);
+            meta.i32(primitive.material);
+            meta.i32(primitive.indices);
+            meta.i32(primitive.mode);
+            meta.count(primitive.targets.size());
+            for (const auto& target : primitive.targets) meta.attributes(target);
+        }
+    }
+
+    meta.count(model.materials.size());
+    for (const tinygltf::Material& material : model.materials) {
+        const tinygltf::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+        meta.str(material.name);
+        meta.doubles(material.emissiveFactor);
+        meta.str(material.alphaMode);
+        meta.f64(material.alphaCutoff);
+        meta.u32(material.doubleSided ? 1 : 0);
+        meta.doubles(pbr.baseColorFactor);
+        meta.texture(pbr.baseColorTexture.index, pbr.baseColorTexture.texCoord);
+        meta.f64(pbr.metallicFactor);
+        meta.f64(pbr.roughnessFactor);
+        meta.texture(pbr.metallicRoughnessTexture.index, pbr.metallicRoughnessTexture.texCoord);
+        meta.texture(material.normalTexture.index, material.normalTexture.texCoord);
+        meta.f64(material.normalTexture.scale);
+        meta.texture(material.occlusionTexture.index, material.occlusionTexture.texCoord);
+        meta.f64(material.occlusionTexture.strength);
+        meta.texture(material.emissiveTexture.index, material.emissiveTexture.texCoord);
+    }
+
+    meta.count(model.nodes.size());
+    for (const tinygltf::Node& node : model.nodes) {
+        meta.str(node.name);
+        meta.i32(node.camera);
+        meta.i32(node.skin);
+        meta.i32(node.mesh);
+        meta.ints(node.children);
+        meta.doubles(node.rotation);
+        meta.doubles(node.scale);
+        meta.doubles(node.translation);
+        meta.doubles(node.matrix);
+        meta.doubles(node.weights);
+    }
+
+    meta.count(model.skins.size());
+    for (const tinygltf::Skin& skin : model.skins) {
+        meta.str(skin.name);
+        meta.i32(skin.inverseBindMatrices);
+        meta.i32(skin.skeleton);
+        meta.ints(skin.joints);
+    }
+
+    meta.count(model.animations.size());
+    for (const tinygltf::Animation& animation : model.animations) {
+        meta.str(animation.name);
+        meta.count(animation.channels.size());
+        for (const tinygltf::AnimationChannel& channel : animation.channels) {
+            meta.i32(channel.sampler);
+            meta.i32(channel.target_node);
+            meta.str(channel.target_path);
+        }
+        meta.count(animation.samplers.size());
+        for (const tinygltf::AnimationSampler& sampler : animation.samplers) {
+            meta.i32(sampler.input);
+            meta.i32(sampler.output);
+            meta.str(sampler.interpolation);
+        }
+    }
+
+    meta.count(model.textures.size());
+    for (const tinygltf::Texture& texture : model.textures) {
+        meta.str(texture.name);
+        meta.i32(texture.sampler);
+        meta.i32(texture.source);
+    }
+
+    // Images by reference only, pixels are decoded by Texture from the uri
+    meta.count(model.images.size());
+    for (const tinygltf::Image& image : model.images) {
+        meta.str(image.name);
+        meta.str(image.uri);
+        meta.str(image.mimeType);
+        meta.i32(image.bufferView);
+        meta.i32(image.width);
+        meta.i32(image.height);
+        meta.i32(image.component);
+        meta.i32(image.bits);
+        meta.i32(image.pixel_type);
+    }
+
+    meta.count(model.samplers.size());
+    for (const tinygltf::Sampler& sampler : model.samplers) {
+        meta.str(sampler.name);
+        meta.i32(sampler.minFilter);
+        meta.i32(sampler.magFilter);
+        meta.i32(sampler.wrapS);
+        meta.i32(sampler.wrapT);
+    }
+
+    meta.count(model.scenes.size());
+    for (const tinygltf::Scene& scene : model.scenes) {
+        meta.str(scene.name);
+        meta.ints(scene.nodes);
+    }
+
+    CookedHeader header;
+    std::memcpy(header.magic, COOKED_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.metadataSize = meta.bytes.size();
+    header.dataOffset = alignUp(sizeof(CookedHeader) + meta.bytes.size());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        err = "cannot open " + path + " for writing";
+        return false;
+    }
+    const char padding[DATA_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(meta.bytes.data()), meta.bytes.size());
+    out.write(padding, header.dataOffset - sizeof(CookedHeader) - meta.bytes.size());
+    for (size_t i = 0; i < model.buffers.size(); i++) {
+        const std::vector<unsigned char>& data = model.buffers[i].data;
+        out.write(reinterpret_cast<const char*>(data.data()), data.size());
+        out.write(padding, alignUp(data.size()) - data.size());
+    }
+    if (!out) {
+        err = "failed writing " + path;
+        return false;
+    }
+    return true;
+}
+
+bool CookedModel::read(const std::string& path, tinygltf::Model& model, std::string& err) {
+    MappedFile file;
+    if (!file.open(path)) {
+        err = "cannot map " + path;
+        return false;
+    }
+    CookedHeader header;
+    if (file.size() < sizeof(header)) {
+        err = path + " is truncated";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, COOKED_MAGIC, sizeof(header.magic)) != 0 || header.version != VERSION) {
+        err = path + " is not a version " + std::to_string(VERSION) + " cooked model";
+        return false;
+    }
+    if (header.metadataSize > file.size() - sizeof(header) || header.dataOffset > file.size()) {
+        err = path + " is truncated";
+        return false;
+    }
+
+    const unsigned char* metaBegin = file.data() + sizeof(header);
+    BlobReader meta(metaBegin, metaBegin + header.metadataSize);
+    const unsigned char* data = file.data() + header.dataOffset;
+    uint64_t dataSize = file.size() - header.dataOffset;
+
+    model = tinygltf::Model();
+    model.asset.version = meta.str();
+    model.asset.generator = meta.str();
+    model.defaultScene = meta.i32();
+
+    model.buffers.resize(meta.count());
+    for (tinygltf::Buffer& buffer : model.buffers) {
+        buffer.name = meta.str();
+        uint64_t offset = meta.u64();
+        uint64_t size = meta.u64();
+        if (!meta.ok || offset > dataSize || size > dataSize - offset) {
+            err = path + " has a buffer outside the file";
+            model = tinygltf::Model();
+            return false;
+        }
+        // tinygltf::Buffer owns its bytes, so this is the one copy out of the mapping
+        buffer.data.assign(data + offset, data + offset + size);
+    }
+
+    model.bufferViews.resize(meta.count());
+    for (tinygltf::BufferView& view : model.bufferViews) {
+        view.name = meta.str();
+        view.buffer = meta.i32();
+        view.byteOffset = meta.u64();
+        view.byteLength = meta.u64();
+        view.byteStride = meta.u64();
+        view.target = meta.i32();
+    }
+
+    model.accessors.resize(meta.count());
+    for (tinygltf::Accessor& accessor : model.accessors) {
+        accessor.name = meta.str();
+        accessor.bufferView = meta.i32();
+        accessor.byteOffset = meta.u64();
+        accessor.normalized = meta.u32() != 0;
+        accessor.componentType = meta.i32();
+        accessor.count = meta.u64();
+        accessor.type = meta.i32();
+        accessor.minValues = meta.doubles();
+        accessor.maxValues = meta.doubles();
+    }
+
+    model.meshes.resize(meta.count());
+    for (tinygltf::Mesh& mesh : model.meshes) {
+        mesh.name = meta.str();
+        mesh.weights = meta.doubles();
+        mesh.primitives.resize(meta.count());
+        for (tinygltf::Primitive& primitive : mesh.primitives) {
+            primitive.attributes = meta.attributes();
+            primitive.material = meta.i32();
+            primitive.indices = meta.i32();
+            primitive.mode = meta.i32();
+            primitive.targets.resize(meta.count());
+            for (auto& target : primitive.targets) target = meta.attributes();
+        }
+    }
+
+    model.materials.resize(meta.count());
+    for (tinygltf::Material& material : model.materials) {
+        tinygltf::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+        material.name = meta.str();
+        material.emissiveFactor = meta.doubles();
+        material.alphaMode = meta.str();
+        material.alphaCutoff = meta.f64();
+        material.doubleSided = meta.u32() != 0;
+        pbr.baseColorFactor = meta.doubles();
+        meta.texture(pbr.baseColorTexture);
+        pbr.metallicFactor = meta.f64();
+        pbr.roughnessFactor = meta.f64();
+        meta.texture(pbr.metallicRoughnessTexture);
+        meta.texture(material.normalTexture);
+        material.normalTexture.scale = meta.f64();
+        meta.texture(material.occlusionTexture);
+        material.occlusionTexture.strength = meta.f64();
+        meta.texture(material.emissiveTexture);
+    }
+
+    model.nodes.resize(meta.count());
+    for (tinygltf::Node& node : model.nodes) {
+        node.name = meta.str();
+        node.camera = meta.i32();
+        node.skin = meta.i32();
+        node.mesh = meta.i32();
+        node.children = meta.ints();
+        node.rotation = meta.doubles();
+        node.scale = meta.doubles();
+        node.translation = meta.doubles();
+        node.matrix = meta.doubles();
+        node.weights = meta.doubles();
+    }
+
+    model.skins.resize(meta.count());
+    for (tinygltf::Skin& skin : model.skins) {
+        skin.name = meta.str();
+        skin.inverseBindMatrices = meta.i32();
+        skin.skeleton = meta.i32();
+        skin.joints = meta.ints();
+    }
+
+    model.animations.resize(meta.count());
+    for (tinygltf::Animation& animation : model.animations) {
+        animation.name = meta.str();
+        animation.channels.resize(meta.count());
+        for (tinygltf::AnimationChannel& channel : animation.channels) {
+            channel.sampler = meta.i32();
+            channel.target_node = meta.i32();
+            channel.target_path = meta.str();
+        }
+        animation.samplers.resize(meta.count());
+        for (tinygltf::AnimationSampler& sampler : animation.samplers) {
+            sampler.input = meta.i32();
+            sampler.output = meta.i32();
+            sampler.interpolation = meta.str();
+        }
+    }
+
+    model.textures.resize(meta.count());
+    for (tinygltf::Texture& texture : model.textures) {
+        texture.name = meta.str();
+        texture.sampler = meta.i32();
+        texture.source = meta.i32();
+    }
+
+    model.images.resize(meta.count());
+    for (tinygltf::Image& image : model.images) {
+        image.name = meta.str();
+        image.uri = meta.str();
+        image.mimeType = meta.str();
+        image.bufferView = meta.i32();
+        image.width = meta.i32();
+        image.height = meta.i32();
+        image.component = meta.i32();
+        image.bits = meta.i32();
+        image.pixel_type = meta.i32();
+    }
+
+    model.samplers.resize(meta.count());
+    for (tinygltf::Sampler& sampler : model.samplers) {
+        sampler.name = meta.str();
+        sampler.minFilter = meta.i32();
+        sampler.magFilter = meta.i32();
+        sampler.wrapS = meta.i32();
+        sampler.wrapT = meta.i32();
+    }
+
+    model.scenes.resize(meta.count());
+    for (tinygltf::Scene& scene : model.scenes) {
+        scene.name = meta.str();
+        scene.nodes = meta.ints();
+    }
+
+    if (!meta.ok) {
+        err = path + " is truncated";
+        model = tinygltf::Model();
+        return false;
+    }
+    // The metadata parsed, but a stale or corrupt file can still point outside what it holds
+    std::string broken = checkReferences(model);
+    if (!broken.empty()) {
+        err = path + ": " + broken;
+        model = tinygltf::Model();
+        return false;
+    }
+    return true;
+}
+
+bool CookedModel::load(const std::string& gltfPath, tinygltf::Model& model, std::string& err, std::string& warn) {
+    std::string cookedPath = pathFor(gltfPath);
+    struct stat cookedInfo, gltfInfo;
+    if (stat(cookedPath.c_str(), &cookedInfo) == 0) {
+        // A glTF edited after cooking wins; a cooked file shipped without its glTF is fine
+        bool stale = stat(gltfPath.c_str(), &gltfInfo) == 0 && cookedInfo.st_mtime < gltfInfo.st_mtime;
+        if (stale) {
+            std::cout << "[CookedModel] " << cookedPath << " is older than " << gltfPath << ", re-run model_cooker" << std::endl;
+        } else {
+            std::string cookedErr;
+            if (read(cookedPath, model, cookedErr)) return true;
+            std::cerr << "[CookedModel] " << cookedErr << ", loading " << gltfPath << " instead" << std::endl;
+        }
+    }
+
+    tinygltf::TinyGLTF loader;
+    return loader.LoadASCIIFromFile(&model, &err, &warn, gltfPath);
+}
@@ -0,0 +1,48 @@
+#ifndef COOKEDMODEL_HPP
+#define COOKEDMODEL_HPP
+
+#include <tiny_gltf.h>
+#include <string>
+
+/**
+ * @brief Flat binary ("cooked") copy of a glTF model, written offline by model_cooker.
+ *
+ * A cooked file holds everything the renderer reads from a tinygltf::Model: buffers (vertex/index
+ * streams, inverse bind matrices, animation keyframes), buffer views, accessors, meshes, materials,
+ * the node hierarchy, skins, animations, textures/images (by uri) and scenes.
+ * Loading it maps the file and fills the structs directly: no JSON parsing, no separate .bin read,
+ * and no image decoding (Texture loads the images from their uri anyway).
+ *
+ * Layout (little endian): header (magic, version, metadata size, data offset), the metadata as a
+ * sequence of counted arrays, then every buffer's bytes, 16-byte aligned.
+ */
+class CookedModel {
+    public:
+        static const unsigned int VERSION = 1;
+
+        /**
+         * @brief Where the cooked copy of a glTF file lives: "dir/scene.gltf" -> "dir/scene.cooked"
+         */
+        static std::string pathFor(const std::string& gltfPath);
+
+        /**
+         * @brief Write model to path
+         * @return false (with err set) if the model uses something the format does not store, or on I/O errors
+         */
+        static bool write(const tinygltf::Model& model, const std::string& path, std::string& err);
+
+        /**
+         * @brief Read a cooked file into model
+         * @return false (with err set, model empty) if the file is missing, truncated, from another version,
+         * or refers to buffers, views or accessors outside what it holds
+         */
+        static bool read(const std::string& path, tinygltf::Model& model, std::string& err);
+
+        /**
+         * @brief Load a glTF model, from its cooked copy when one exists and is not older than the glTF
+         * (falls back to tinygltf's JSON loader otherwise). err/warn are filled like tinygltf does.
+         */
+        static bool load(const std::string& gltfPath, tinygltf::Model& model, std::string& err, std::string& warn);
+};
+
+#endif // COOKEDMODEL_HPP
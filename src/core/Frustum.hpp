@@ -0,0 +1,73 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+/**
+ * @brief The six clip planes of a view-projection matrix, for culling axis-aligned boxes on the CPU.
+ * Planes point inwards and are not normalised (only the sign of the distance is used).
+ */
+struct Frustum {
+    glm::vec4 planes[6];
+
+    explicit Frustum(const glm::mat4& vp) {
+        // Gribb/Hartmann: each plane is row 3 +- row i of the matrix (glm is column-major)
+        glm::vec4 row0(vp[0][0], vp[1][0], vp[2][0], vp[3][0]);
+        glm::vec4 row1(vp[0][1], vp[1][1], vp[2][1], vp[3][1]);
+        glm::vec4 row2(vp[0][2], vp[1][2], vp[2][2], vp[3][2]);
+        glm::vec4 row3(vp[0][3], vp[1][3], vp[2][3], vp[3][3]);
+        planes[0] = row3 + row0; // left
+        planes[1] = row3 - row0; // right
+        planes[2] = row3 + row1; // bottom
+        planes[3] = row3 - row1; // top
+        planes[4] = row3 + row2; // near
+        planes[5] = row3 - row2; // far
+    }
+
+    /**
+     * @brief False only if the box is entirely outside one plane (may keep a few boxes near the corners)
+     */
+    bool intersectsBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+        for (int i = 0; i < 6; i++) {
+            const glm::vec4& p = planes[i];
+            // Corner furthest along the plane normal
+            glm::vec3 corner(p.x >= 0.0f ? boxMax.x : boxMin.x,
+                             p.y >= 0.0f ? boxMax.y : boxMin.y,
+                             p.z >= 0.0f ? boxMax.z : boxMin.z);
+            if (p.x * corner.x + p.y * corner.y + p.z * corner.z + p.w < 0.0f) return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Faces of a cube shadow map centred on eye that can see the box, bit i set for face i.
+ * Faces are in ShadowMap's order (+X, -X, +Y, -Y, +Z, -Z), each a 90 degree frustum with no far plane.
+ */
+inline unsigned int cubeFacesSeeingBox(const glm::vec3& eye, const glm::vec3& boxMin, const glm::vec3& boxMax) {
+    const glm::vec3 lo = boxMin - eye;
+    const glm::vec3 hi = boxMax - eye;
+    unsigned int mask = 0;
+    for (int face = 0; face < 6; face++) {
+        const int axis = face / 2;
+        const float sign = (face % 2 == 0) ? 1.0f : -1.0f;
+        bool visible = true;
+        // Four side planes through the eye: sign * d[axis] +- d[other] >= 0
+        for (int k = 1; k <= 2 && visible; k++) {
+            const int other = (axis + k) % 3;
+            for (int s = -1; s <= 1 && visible; s += 2) {
+                glm::vec3 normal(0.0f);
+                normal[axis] = sign;
+                normal[other] = static_cast<float>(s);
+                glm::vec3 corner(normal.x >= 0.0f ? hi.x : lo.x,
+                                 normal.y >= 0.0f ? hi.y : lo.y,
+                                 normal.z >= 0.0f ? hi.z : lo.z);
+                visible = glm::dot(normal, corner) >= 0.0f;
+            }
+        }
+        if (visible) mask |= 1u << face;
+    }
+    return mask;
+}
+
+#endif // FRUSTUM_HPP
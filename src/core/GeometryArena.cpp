@@ -0,0 +1,249 @@
+#include "GeometryArena.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const size_t MIN_BUFFER_BYTES = 1 << 20;
+
+size_t componentBytes(int componentType) {
+    switch (componentType) {
+        case TINYGLTF_COMPONENT_TYPE_BYTE:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: return 1;
+        case TINYGLTF_COMPONENT_TYPE_SHORT:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: return 2;
+        case TINYGLTF_COMPONENT_TYPE_INT:
+        case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        case TINYGLTF_COMPONENT_TYPE_FLOAT: return 4;
+        default: return 0;
+    }
+}
+
+// Components per element of a vertex attribute accessor, 0 for matrices
+int componentCount(int type) {
+    if (type == TINYGLTF_TYPE_SCALAR) return 1;
+    if (type == TINYGLTF_TYPE_VEC2 || type == TINYGLTF_TYPE_VEC3 || type == TINYGLTF_TYPE_VEC4) return type;
+    return 0;
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Start of an accessor's data, or nullptr if it doesn't fit inside its buffer
+const unsigned char* accessorData(const tinygltf::Model& model, const tinygltf::Accessor& accessor,
+                                  size_t elementBytes, int& stride) {
+    if (accessor.bufferView < 0 || accessor.bufferView >= (int)model.bufferViews.size()) return nullptr;
+    const tinygltf::BufferView& view = model.bufferViews[accessor.bufferView];
+    if (view.buffer < 0 || view.buffer >= (int)model.buffers.size()) return nullptr;
+    const tinygltf::Buffer& buffer = model.buffers[view.buffer];
+    stride = accessor.ByteStride(view);
+    if (stride <= 0 || accessor.count == 0) return nullptr;
+    size_t begin = view.byteOffset + accessor.byteOffset;
+    size_t end = begin + (accessor.count - 1) * (size_t)stride + elementBytes;
+    if (end > buffer.data.size()) return nullptr;
+    return buffer.data.data() + begin;
+}
+
+}
+
+std::map<std::vector<GLuint>, GeometryArena::VertexPool> GeometryArena::pools;
+GLuint GeometryArena::indexBuffer = 0;
+size_t GeometryArena::indexCapacity = 0;
+size_t GeometryArena::indexUsed = 0;
+
+int GeometryArena::attributeLocation(const std::string& name) {
+    if (name == "POSITION") return 0;
+    if (name == "NORMAL") return 1;
+    if (name == "TEXCOORD_0") return 2;
+    if (name == "JOINTS_0") return 3;
+    if (name == "WEIGHTS_0") return 4;
+    if (name == "TANGENT") return 5;
+    if (name == "TEXCOORD_1") return 6;
+    if (name == "TEXCOORD_2") return 7;
+    return -1;
+}
+
+bool GeometryArena::add(const tinygltf::Model& model, const tinygltf::Primitive& primitive, ArenaGeometry& out) {
+    if (primitive.indices < 0 || primitive.indices >= (int)model.accessors.size()) return false;
+
+    // Vertex layout of the primitive, attributes the shaders don't read are dropped
+    std::vector<Attribute> attributes;
+    std::vector<const tinygltf::Accessor*> accessors;
+    size_t vertexCount = 0;
+    for (const auto& attrib : primitive.attributes) {
+        int location = attributeLocation(attrib.first);
+        if (location < 0 || attrib.second < 0 || attrib.second >= (int)model.accessors.size()) continue;
+        const tinygltf::Accessor& accessor = model.accessors[attrib.second];
+        int components = componentCount(accessor.type);
+        size_t bytes = components * componentBytes(accessor.componentType);
+        if (bytes == 0) return false;
+        if (attributes.empty()) vertexCount = accessor.count;
+        else if (accessor.count != vertexCount) return false;
+
+        Attribute attribute;
+        attribute.location = (GLuint)location;
+        attribute.size = components;
+        attribute.componentType = (GLenum)accessor.componentType;
+        attribute.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+        attribute.offset = 0;
+        attribute.bytes = (GLsizei)bytes;
+        attributes.push_back(attribute);
+        accessors.push_back(&accessor);
+    }
+    if (attributes.empty()) return false;
+
+    // Sort by location so equal layouts get equal keys; offsets are 4-byte aligned
+    std::vector<size_t> order(attributes.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return attributes[a].location < attributes[b].location; });
+    std::vector<Attribute> sorted;
+    std::vector<const tinygltf::Accessor*> sortedAccessors;
+    std::vector<GLuint> key;
+    GLsizei stride = 0;
+    for (size_t i : order) {
+        Attribute attribute = attributes[i];
+        attribute.offset = stride;
+        stride += (GLsizei)alignUp(attribute.bytes, 4);
+        sorted.push_back(attribute);
+        sortedAccessors.push_back(accessors[i]);
+        key.push_back(attribute.location);
+        key.push_back((GLuint)attribute.size);
+        key.push_back(attribute.componentType);
+        key.push_back(attribute.normalized);
+    }
+
+    // Interleave the vertices
+    std::vector<unsigned char> vertices(vertexCount * stride, 0);
+    for (size_t a = 0; a < sorted.size(); a++) {
+        int srcStride;
+        const unsigned char* src = accessorData(model, *sortedAccessors[a], sorted[a].bytes, srcStride);
+        if (!src) return false;
+        unsigned char* dst = vertices.data() + sorted[a].offset;
+        for (size_t v = 0; v < vertexCount; v++) {
+            std::memcpy(dst + v * stride, src + v * srcStride, sorted[a].bytes);
+        }
+    }
+
+    // Indices keep their type, except bytes which are widened (GL_UNSIGNED_BYTE indices are slow on most GPUs)
+    const tinygltf::Accessor& indexAccessor = model.accessors[primitive.indices];
+    size_t srcIndexBytes = componentBytes(indexAccessor.componentType);
+    if (indexAccessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+        indexAccessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT &&
+        indexAccessor.componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) return false;
+    int srcIndexStride;
+    const unsigned char* srcIndices = accessorData(model, indexAccessor, srcIndexBytes, srcIndexStride);
+    if (!srcIndices) return false;
+    GLenum indexType = indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+    size_t indexBytes = indexType == GL_UNSIGNED_INT ? 4 : 2;
+    std::vector<unsigned char> indices(indexAccessor.count * indexBytes);
+    for (size_t i = 0; i < indexAccessor.count; i++) {
+        const unsigned char* src = srcIndices + i * srcIndexStride;
+        if (srcIndexBytes == 1) {
+            unsigned short index = *src;
+            std::memcpy(&indices[i * 2], &index, 2);
+        } else {
+            std::memcpy(&indices[i * indexBytes], src, indexBytes);
+        }
+    }
+
+    // Allocate. Keep no VAO bound, so uploads can't change any VAO's element binding.
+    glBindVertexArray(0);
+
+    size_t indexOffset = alignUp(indexUsed, 4);
+    GLuint oldIndexBuffer = indexBuffer;
+    reserve(indexBuffer, indexCapacity, indexOffset, indices.size());
+    if (indexBuffer != oldIndexBuffer) {
+        for (auto& entry : pools) bindLayout(entry.second);
+    }
+
+    bool newPool = pools.find(key) == pools.end();
+    VertexPool& pool = pools[key];
+    if (newPool) {
+        pool.attributes = sorted;
+        pool.stride = stride;
+        glGenVertexArrays(1, &pool.vao);
+        pool.buffer = 0;
+        pool.capacity = 0;
+        pool.used = 0;
+    }
+    GLuint oldVertexBuffer = pool.buffer;
+    reserve(pool.buffer, pool.capacity, pool.used, vertices.size());
+    if (newPool || pool.buffer != oldVertexBuffer) bindLayout(pool);
+
+    glBindBuffer(GL_ARRAY_BUFFER, pool.buffer);
+    glBufferSubData(GL_ARRAY_BUFFER, pool.used, vertices.size(), vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, indexBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, indexOffset, indices.size(), indices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    out.vao = pool.vao;
+    out.indexType = indexType;
+    out.indexCount = (GLsizei)indexAccessor.count;
+    out.indexOffset = indexOffset;
+    out.baseVertex = (GLint)(pool.used / stride);
+
+    pool.used += vertices.size();
+    indexUsed = indexOffset + indices.size();
+    return true;
+}
+
+void GeometryArena::draw(const ArenaGeometry& geometry, GLenum mode) {
+    glDrawElementsBaseVertex(mode, geometry.indexCount, geometry.indexType,
+                             reinterpret_cast<const void*>(geometry.indexOffset), geometry.baseVertex);
+}
+
+size_t GeometryArena::getVertexBytes() {
+    size_t bytes = 0;
+    for (const auto& entry : pools) bytes += entry.second.used;
+    return bytes;
+}
+
+void GeometryArena::bindLayout(const VertexPool& pool) {
+    glBindVertexArray(pool.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.buffer);
+    for (const Attribute& attribute : pool.attributes) {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.componentType, attribute.normalized,
+                              pool.stride, reinterpret_cast<const void*>((size_t)attribute.offset));
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::reserve(GLuint& buffer, size_t& capacity, size_t used, size_t needed) {
+    if (used + needed <= capacity) return;
+
+    size_t newCapacity = std::max(std::max(capacity * 2, used + needed), MIN_BUFFER_BYTES);
+    GLuint newBuffer;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newCapacity, nullptr, GL_STATIC_DRAW);
+    if (buffer) {
+        // Move what is already allocated without a round trip through the CPU
+        if (used > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+            glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+        std::cout << "[GeometryArena] Grew buffer to " << newCapacity / 1024 << " KB" << std::endl;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    buffer = newBuffer;
+    capacity = newCapacity;
+}
+
+void GeometryArena::cleanup() {
+    for (auto& entry : pools) {
+        glDeleteVertexArrays(1, &entry.second.vao);
+        glDeleteBuffers(1, &entry.second.buffer);
+    }
+    pools.clear();
+    if (indexBuffer) glDeleteBuffers(1, &indexBuffer);
+    indexBuffer = 0;
+    indexCapacity = 0;
+    indexUsed = 0;
+}
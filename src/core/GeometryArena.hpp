@@ -0,0 +1,82 @@
+#ifndef GEOMETRYARENA_HPP
+#define GEOMETRYARENA_HPP
+
+#include <glad/gl.h>
+#include <tiny_gltf.h>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// Where a primitive's geometry lives in the GeometryArena
+struct ArenaGeometry {
+    GLuint vao = 0;          // VAO of the primitive's vertex layout, 0 if the primitive is not in the arena
+    GLenum indexType = 0;
+    GLsizei indexCount = 0;
+    size_t indexOffset = 0;  // Byte offset in the shared index buffer
+    GLint baseVertex = 0;    // First vertex in the layout's vertex buffer
+};
+
+/**
+ * @brief Shared GPU storage for all model geometry.
+ *
+ * Vertices are interleaved into one vertex buffer per vertex layout (which attributes, and in which
+ * formats), with one VAO per layout; indices of every model share one index buffer, bound in all of them.
+ * Primitives are suballocated (bump allocation, models are never unloaded) and drawn with
+ * glDrawElementsBaseVertex, so consecutive primitives of the same layout need no VAO or buffer switches.
+ * Buffers grow by copying into a bigger buffer on the GPU; VAOs are re-pointed, ArenaGeometry stays valid.
+ */
+class GeometryArena {
+    public:
+        /**
+         * @brief Attribute location used by the model shaders for a glTF attribute name, -1 if unused
+         */
+        static int attributeLocation(const std::string& name);
+
+        /**
+         * @brief Copy a glTF primitive's vertices and indices into the arena. Needs a GL context.
+         * @return false (out untouched) if the primitive has no indices or its attributes can't be packed
+         */
+        static bool add(const tinygltf::Model& model, const tinygltf::Primitive& primitive, ArenaGeometry& out);
+
+        /**
+         * @brief Draw a primitive from the currently bound VAO, which must be geometry.vao
+         */
+        static void draw(const ArenaGeometry& geometry, GLenum mode);
+
+        static size_t getVertexBytes();
+        static size_t getIndexBytes() { return indexUsed; }
+        static size_t getLayoutCount() { return pools.size(); }
+
+        static void cleanup();
+
+    private:
+        struct Attribute {
+            GLuint location;
+            GLint size;
+            GLenum componentType;
+            GLboolean normalized;
+            GLsizei offset;   // Within the interleaved vertex
+            GLsizei bytes;    // Unpadded element size
+        };
+
+        struct VertexPool {
+            std::vector<Attribute> attributes;
+            GLsizei stride;
+            GLuint vao;
+            GLuint buffer;
+            size_t capacity;  // Bytes
+            size_t used;      // Bytes, always a multiple of stride
+        };
+
+        // Layout key: (location, size, componentType, normalized) per attribute, sorted by location
+        static std::map<std::vector<GLuint>, VertexPool> pools;
+        static GLuint indexBuffer;
+        static size_t indexCapacity;
+        static size_t indexUsed;
+
+        static void bindLayout(const VertexPool& pool);
+        static void reserve(GLuint& buffer, size_t& capacity, size_t used, size_t needed);
+};
+
+#endif // GEOMETRYARENA_HPP
@@ -0,0 +1,77 @@
+#include "GridIndexCache.hpp"
+#include "utils.hpp"
+#include <vector>
+
+std::map<unsigned int, GridIndexBuffer> GridIndexCache::buffers;
+std::map<std::pair<unsigned int, unsigned int>, GridPatchIndexBuffer> GridIndexCache::patchedBuffers;
+
+GridIndexBuffer GridIndexCache::get(unsigned int size) {
+    std::map<unsigned int, GridIndexBuffer>::iterator it = buffers.find(size);
+    if (it != buffers.end()) {
+        return it->second;
+    }
+
+    std::vector<unsigned int> indices = generate_grid_strip_indices(size, RESTART_INDEX);
+    GridIndexBuffer grid;
+    grid.count = static_cast<GLsizei>(indices.size());
+    glGenBuffers(1, &grid.bufferID);
+    // Upload through GL_ARRAY_BUFFER so the element binding of whatever VAO is bound stays untouched
+    glBindBuffer(GL_ARRAY_BUFFER, grid.bufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    buffers[size] = grid;
+    return grid;
+}
+
+void GridIndexCache::draw(const GridIndexBuffer& grid) {
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(RESTART_INDEX);
+    glDrawElements(GL_TRIANGLE_STRIP, grid.count, GL_UNSIGNED_INT, 0);
+    glDisable(GL_PRIMITIVE_RESTART);
+}
+
+const GridPatchIndexBuffer& GridIndexCache::getPatched(unsigned int size, unsigned int patchQuads) {
+    std::pair<unsigned int, unsigned int> key(size, patchQuads);
+    std::map<std::pair<unsigned int, unsigned int>, GridPatchIndexBuffer>::iterator it = patchedBuffers.find(key);
+    if (it != patchedBuffers.end()) {
+        return it->second;
+    }
+
+    std::vector<unsigned int> patchStarts;
+    std::vector<unsigned int> indices = generate_grid_patch_strip_indices(size, patchQuads, RESTART_INDEX, patchStarts);
+    GridPatchIndexBuffer grid;
+    grid.patchQuads = patchQuads;
+    grid.patchesPerSide = (size - 1 + patchQuads - 1) / patchQuads;
+    for (size_t i = 0; i + 1 < patchStarts.size(); i++) {
+        grid.counts.push_back(static_cast<GLsizei>(patchStarts[i + 1] - patchStarts[i]));
+        grid.offsets.push_back(reinterpret_cast<const void*>(sizeof(unsigned int) * patchStarts[i]));
+    }
+    glGenBuffers(1, &grid.bufferID);
+    // Same as get(): keep the bound VAO's element binding untouched
+    glBindBuffer(GL_ARRAY_BUFFER, grid.bufferID);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    return patchedBuffers[key] = grid;
+}
+
+void GridIndexCache::drawPatches(const GLsizei* counts, const void* const* offsets, GLsizei drawCount) {
+    if (drawCount <= 0) return;
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(RESTART_INDEX);
+    glMultiDrawElements(GL_TRIANGLE_STRIP, counts, GL_UNSIGNED_INT, offsets, drawCount);
+    glDisable(GL_PRIMITIVE_RESTART);
+}
+
+void GridIndexCache::cleanup() {
+    for (std::map<unsigned int, GridIndexBuffer>::iterator it = buffers.begin(); it != buffers.end(); ++it) {
+        glDeleteBuffers(1, &it->second.bufferID);
+    }
+    buffers.clear();
+    for (std::map<std::pair<unsigned int, unsigned int>, GridPatchIndexBuffer>::iterator it = patchedBuffers.begin();
+         it != patchedBuffers.end(); ++it) {
+        glDeleteBuffers(1, &it->second.bufferID);
+    }
+    patchedBuffers.clear();
+}
@@ -0,0 +1,63 @@
+#ifndef GRIDINDEXCACHE_HPP
+#define GRIDINDEXCACHE_HPP
+
+#include <glad/gl.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Shared element buffer for a square vertex grid
+struct GridIndexBuffer {
+    GLuint bufferID;
+    GLsizei count;
+};
+
+// Shared element buffer for a square vertex grid cut into square patches, one draw range per patch
+struct GridPatchIndexBuffer {
+    GLuint bufferID;
+    unsigned int patchQuads;     // Quads per patch side (the last row/column of patches may be smaller)
+    unsigned int patchesPerSide;
+    std::vector<GLsizei> counts;        // Index count of patch px + pz * patchesPerSide
+    std::vector<const void*> offsets;   // Byte offset of that patch in the buffer, for glMultiDrawElements
+};
+
+/**
+ * @brief One GPU index buffer per grid size, shared by everything that draws that size of grid
+ * (the Terrain grid, terrain chunks, clipmap levels, ...).
+ *
+ * The indices are triangle strips, one per row of quads, separated by RESTART_INDEX
+ * (see generate_grid_strip_indices). Bind the buffer into the VAO, then draw with draw().
+ */
+class GridIndexCache {
+    public:
+        static const GLuint RESTART_INDEX = 0xFFFFFFFFu;
+
+        /**
+         * @brief Index buffer for a size x size vertex grid, uploaded on first use. Needs a GL context.
+         */
+        static GridIndexBuffer get(unsigned int size);
+
+        /**
+         * @brief Draw the grid from the currently bound VAO, which must have grid.bufferID bound
+         */
+        static void draw(const GridIndexBuffer& grid);
+
+        /**
+         * @brief Patch-ordered index buffer for a size x size vertex grid, uploaded on first use.
+         * Every patch is its own run of strips, so any subset of patches is one glMultiDrawElements.
+         */
+        static const GridPatchIndexBuffer& getPatched(unsigned int size, unsigned int patchQuads);
+
+        /**
+         * @brief Draw drawCount patch ranges (taken from a GridPatchIndexBuffer) from the currently bound VAO
+         */
+        static void drawPatches(const GLsizei* counts, const void* const* offsets, GLsizei drawCount);
+
+        static void cleanup();
+
+    private:
+        static std::map<unsigned int, GridIndexBuffer> buffers;
+        static std::map<std::pair<unsigned int, unsigned int>, GridPatchIndexBuffer> patchedBuffers;
+};
+
+#endif // GRIDINDEXCACHE_HPP
@@ -2,6 +2,7 @@
 #define LOADABLE_HPP
 
 #include <glfw/glfw3.h>
+#include "GeometryArena.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -14,7 +15,8 @@
 // Each VAO corresponds to each mesh primitive in the GLTF model
 struct PrimitiveObject {
 	GLuint vao;
-	std::map<int, GLuint> vbos;
+	std::map<int, GLuint> vbos;      // Per bufferView buffers, empty for primitives in the GeometryArena
+	ArenaGeometry arena;             // arena.vao != 0: draw from the GeometryArena (vao is the shared layout VAO)
 	int meshIndex;
 	int primitiveIndex;
 };
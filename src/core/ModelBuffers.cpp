@@ -0,0 +1,63 @@
+#include "ModelBuffers.hpp"
+#include <set>
+#include <vector>
+
+ModelGPUBuffers uploadModelBuffers(const tinygltf::Model& model) {
+    // Views read by some primitive, as vertex attributes or indices (all meshes, not just those in the scene)
+    std::set<int> usedViews;
+    for (const tinygltf::Mesh& mesh : model.meshes) {
+        for (const tinygltf::Primitive& primitive : mesh.primitives) {
+            for (const auto& attrib : primitive.attributes) {
+                if (attrib.second >= 0 && attrib.second < (int)model.accessors.size()) {
+                    usedViews.insert(model.accessors[attrib.second].bufferView);
+                }
+            }
+            if (primitive.indices >= 0 && primitive.indices < (int)model.accessors.size()) {
+                usedViews.insert(model.accessors[primitive.indices].bufferView);
+            }
+        }
+    }
+
+    ModelGPUBuffers result;
+    // No VAO bound, so binding doesn't change any VAO's element buffer. Buffers are untyped in GL,
+    // each is bound as GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER where it is used.
+    glBindVertexArray(0);
+    for (size_t i = 0; i < model.bufferViews.size(); ++i) {
+        const tinygltf::BufferView& bufferView = model.bufferViews[i];
+        if (usedViews.count((int)i) == 0) {
+            result.skippedBytes += bufferView.byteLength;
+            result.skippedViews++;
+            continue;
+        }
+        const tinygltf::Buffer& buffer = model.buffers[bufferView.buffer];
+
+        GLuint vbo;
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, bufferView.byteLength,
+                     buffer.data.data() + bufferView.byteOffset, GL_STATIC_DRAW);
+        result.vbos[(int)i] = vbo;
+        result.uploadedBytes += bufferView.byteLength;
+        result.uploadedViews++;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return result;
+}
+
+size_t releaseModelBufferData(tinygltf::Model& model) {
+    size_t bytes = 0;
+    for (tinygltf::Buffer& buffer : model.buffers) {
+        bytes += buffer.data.capacity();
+        std::vector<unsigned char>().swap(buffer.data);
+    }
+    return bytes;
+}
+
+size_t releaseModelImageData(tinygltf::Model& model) {
+    size_t bytes = 0;
+    for (tinygltf::Image& image : model.images) {
+        bytes += image.image.capacity();
+        std::vector<unsigned char>().swap(image.image);
+    }
+    return bytes;
+}
@@ -0,0 +1,38 @@
+#ifndef MODELBUFFERS_HPP
+#define MODELBUFFERS_HPP
+
+#include <glad/gl.h>
+#include <tiny_gltf.h>
+#include <cstddef>
+#include <map>
+
+// GPU copies of the bufferViews a glTF model draws from
+struct ModelGPUBuffers {
+    std::map<int, GLuint> vbos;   // bufferView index -> buffer, shared by every primitive reading that view
+    size_t uploadedBytes = 0;
+    size_t skippedBytes = 0;      // Views no vertex/index accessor reads: animation, inverse bind matrices, images
+    int uploadedViews = 0;
+    int skippedViews = 0;
+};
+
+/**
+ * @brief Upload each bufferView that a primitive attribute or index accessor reads, exactly once.
+ * Views only used on the CPU (animation samplers, skins, embedded images) stay off the GPU.
+ * Needs a GL context; leaves no VAO bound.
+ */
+ModelGPUBuffers uploadModelBuffers(const tinygltf::Model& model);
+
+/**
+ * @brief Free the CPU copy of a model's buffers (buffers[].data), keeping all metadata.
+ * Call once the geometry is on the GPU and skin/animation data has been copied out.
+ * @return bytes freed
+ */
+size_t releaseModelBufferData(tinygltf::Model& model);
+
+/**
+ * @brief Free the pixels tinygltf decoded into images[].image (Texture decodes from the uri instead)
+ * @return bytes freed
+ */
+size_t releaseModelImageData(tinygltf::Model& model);
+
+#endif // MODELBUFFERS_HPP
@@ -5,6 +5,8 @@
 #include <string>
 #include <unordered_map>
 #include "core/Texture.hpp"
+#include "CookedModel.hpp"
+#include "ModelBuffers.hpp"
 
 #include <tiny_gltf.h>
 
@@ -118,6 +120,10 @@ void ModelEntity::initialize(bool isSkinned, std::string modelDirectory, std::st
 	// Prepare animation data 
 	animationObjects = prepareAnimation(model);
 
+	// Nothing reads the raw buffers or decoded images after this
+	size_t releasedBytes = releaseModelBufferData(model) + releaseModelImageData(model);
+	std::cout << "Released " << releasedBytes / 1024 << " KB of glTF buffer and image data" << std::endl;
+
 	// Create and compile our GLSL program from the shaders
 
 	shader = std::make_shared<Shader>(vertexShaderPath.c_str(), fragmentShaderPath.c_str());
@@ -378,13 +384,9 @@ void ModelEntity::updateAnimation(
 	// Apply animation channels to TRS
 	for (const auto &channel : anim.channels) {
 		int targetNodeIndex = channel.target_node;
-		const auto &sampler = anim.samplers[channel.sampler];
-
-		const tinygltf::Accessor &outputAccessor = model.accessors[sampler.output];
-		const tinygltf::BufferView &outputBufferView = model.bufferViews[outputAccessor.bufferView];
-		const tinygltf::Buffer &outputBuffer = model.buffers[outputBufferView.buffer];
+		const SamplerObject &sampler = animationObject.samplers[channel.sampler];
 
-		const std::vector<float> &times = animationObject.samplers[channel.sampler].input;
+		const std::vector<float> &times = sampler.input;
 		float animationTime = fmod(time, times.back());
 		int keyframeIndex = findKeyframeIndex(times, animationTime);
 		int nextFrameIndex = glm::min(keyframeIndex + 1, static_cast<int>(times.size() - 1));
@@ -392,31 +394,32 @@ void ModelEntity::updateAnimation(
 		float nextFrameTime = times[nextFrameIndex];
 		float _t = (animationTime - prevFrameTime) / (nextFrameTime - prevFrameTime);
 
-		const unsigned char *outputPtr = &outputBuffer.data[outputBufferView.byteOffset + outputAccessor.byteOffset];
+		// Keyframe values were copied out of the glTF buffers by prepareAnimation (vec3 outputs in xyz)
+		const glm::vec4 *output = sampler.output.data();
 
 		if (channel.target_path == "translation") {
-			glm::vec3 t0, t1;
-			memcpy(&t0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
+			glm::vec3 t0 = glm::vec3(output[keyframeIndex]);
 			if (interpolated) {
-				memcpy(&t1, outputPtr + nextFrameIndex * 3 * sizeof(float), 3 * sizeof(float));
+				glm::vec3 t1 = glm::vec3(output[nextFrameIndex]);
 				trs[targetNodeIndex].T = (1 - _t) * t0 + _t * t1;
 			} else {
 				trs[targetNodeIndex].T = t0;
 			}
 		} else if (channel.target_path == "rotation") {
-			glm::quat r0, r1;
-			memcpy(&r0, outputPtr + keyframeIndex * 4 * sizeof(float), 4 * sizeof(float));
+			// glTF stores rotations as (x, y, z, w), glm::quat takes w first
+			const glm::vec4 &k0 = output[keyframeIndex];
+			glm::quat r0 = glm::quat(k0.w, k0.x, k0.y, k0.z);
 			if (interpolated) {
-				memcpy(&r1, outputPtr + nextFrameIndex * 4 * sizeof(float), 4 * sizeof(float));
+				const glm::vec4 &k1 = output[nextFrameIndex];
+				glm::quat r1 = glm::quat(k1.w, k1.x, k1.y, k1.z);
 				trs[targetNodeIndex].R = glm::slerp(r0, r1, _t);
 			} else {
 				trs[targetNodeIndex].R = r0;
 			}
 		} else if (channel.target_path == "scale") {
-			glm::vec3 s0, s1;
-			memcpy(&s0, outputPtr + keyframeIndex * 3 * sizeof(float), 3 * sizeof(float));
+			glm::vec3 s0 = glm::vec3(output[keyframeIndex]);
 			if (interpolated) {
-				memcpy(&s1, outputPtr + nextFrameIndex * 3 * sizeof(float), 3 * sizeof(float));
+				glm::vec3 s1 = glm::vec3(output[nextFrameIndex]);
 				trs[targetNodeIndex].S = (1 - _t) * s0 + _t * s1;
 			} else {
 				trs[targetNodeIndex].S = s0;
@@ -496,11 +499,10 @@ void ModelEntity::update(float deltaTime) {
 }
 
 bool ModelEntity::loadModel(tinygltf::Model &model, const char *filename) {
-	tinygltf::TinyGLTF loader;
 	std::string err;
 	std::string warn;
 
-	bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+	bool res = CookedModel::load(filename, model, err, warn);
 	if (!warn.empty()) {
 		std::cout << "WARN: " << warn << std::endl;
 	}
@@ -518,31 +520,8 @@ bool ModelEntity::loadModel(tinygltf::Model &model, const char *filename) {
 }
 
 void ModelEntity::bindMesh(std::vector<PrimitiveObject> &primitiveObjects,
-				tinygltf::Model &model, tinygltf::Mesh &mesh, int nodeIndex) {
-
-	std::map<int, GLuint> vbos;
-	for (size_t i = 0; i < model.bufferViews.size(); ++i) {
-		const tinygltf::BufferView &bufferView = model.bufferViews[i];
-
-		int target = bufferView.target;
-		
-		// if (bufferView.target == 0) { 
-		// 	// The bufferView with target == 0 in our model refers to 
-		// 	// the skinning weights, for 25 joints, each 4x4 matrix (16 floats), totaling to 400 floats or 1600 bytes. 
-		// 	// So it is considered safe to skip the warning.
-		// 	//std::cout << "WARN: bufferView.target is zero" << std::endl;
-		// 	continue;
-		// }
-
-		const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-		GLuint vbo;
-		glGenBuffers(1, &vbo);
-		glBindBuffer(target, vbo);
-		glBufferData(target, bufferView.byteLength,
-					&buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-		
-		vbos[i] = vbo;
-	}
+				tinygltf::Model &model, tinygltf::Mesh &mesh, int nodeIndex,
+				const std::map<int, GLuint> &vbos) {
 
 	// Each mesh can contain several primitives (or parts), each we need to 
 	// bind to an OpenGL vertex array object
@@ -559,7 +538,7 @@ void ModelEntity::bindMesh(std::vector<PrimitiveObject> &primitiveObjects,
 			tinygltf::Accessor accessor = model.accessors[attrib.second];
 			int byteStride =
 				accessor.ByteStride(model.bufferViews[accessor.bufferView]);
-			glBindBuffer(GL_ARRAY_BUFFER, vbos[accessor.bufferView]);
+			glBindBuffer(GL_ARRAY_BUFFER, vbos.at(accessor.bufferView));
 
 			int size = 1;
 			if (accessor.type != TINYGLTF_TYPE_SCALAR) {
@@ -694,26 +673,33 @@ int ModelEntity::findKeyframeIndex(const std::vector<float>& times, float animat
 
 void ModelEntity::bindModelNodes(std::vector<PrimitiveObject> &primitiveObjects, 
 						tinygltf::Model &model,
-						tinygltf::Node &node) {
+						tinygltf::Node &node,
+						const std::map<int, GLuint> &vbos) {
 	// Bind buffers for the current mesh at the node
 	if ((node.mesh >= 0) && (node.mesh < model.meshes.size())) {
-		bindMesh(primitiveObjects, model, model.meshes[node.mesh], node.mesh);
+		bindMesh(primitiveObjects, model, model.meshes[node.mesh], node.mesh, vbos);
 	}
 
 	// Recursive into children nodes
 	for (size_t i = 0; i < node.children.size(); i++) {
 		assert((node.children[i] >= 0) && (node.children[i] < model.nodes.size()));
-		bindModelNodes(primitiveObjects, model, model.nodes[node.children[i]]);
+		bindModelNodes(primitiveObjects, model, model.nodes[node.children[i]], vbos);
 	}
 }
 
 std::vector<PrimitiveObject> ModelEntity::bindModel(tinygltf::Model &model) {
 	std::vector<PrimitiveObject> primitiveObjects;
 
+	// One upload of each buffer view the meshes read, shared by every mesh node
+	ModelGPUBuffers buffers = uploadModelBuffers(model);
+	std::cout << "GPU buffers: uploaded " << buffers.uploadedBytes / 1024 << " KB in " << buffers.uploadedViews
+	          << " buffer views, skipped " << buffers.skippedBytes / 1024 << " KB in " << buffers.skippedViews
+	          << " CPU-only views" << std::endl;
+
 	const tinygltf::Scene &scene = model.scenes[model.defaultScene];
 	for (size_t i = 0; i < scene.nodes.size(); ++i) {
 		assert((scene.nodes[i] >= 0) && (scene.nodes[i] < model.nodes.size()));
-		bindModelNodes(primitiveObjects, model, model.nodes[scene.nodes[i]]);
+		bindModelNodes(primitiveObjects, model, model.nodes[scene.nodes[i]], buffers.vbos);
 	}
 
 	return primitiveObjects;
@@ -734,10 +720,13 @@ void ModelEntity::drawMesh(const std::vector<PrimitiveObject> &primitiveObjects,
 		}
 		if (foundIndex == -1) continue;
 
-		GLuint vao = primitiveObjects[foundIndex].vao;
-		std::map<int, GLuint> vbos = primitiveObjects[foundIndex].vbos;
+		const PrimitiveObject &primitiveObject = primitiveObjects[foundIndex];
 
-		glBindVertexArray(vao);
+		// Arena primitives of one vertex layout share a VAO, so only bind on change (drawModel unbinds at the end)
+		if (primitiveObject.vao != boundVertexArray) {
+			glBindVertexArray(primitiveObject.vao);
+			boundVertexArray = primitiveObject.vao;
+		}
 
 		tinygltf::Primitive primitive = mesh.primitives[i];
 		tinygltf::Accessor indexAccessor = model.accessors[primitive.indices];
@@ -825,11 +814,15 @@ void ModelEntity::drawMesh(const std::vector<PrimitiveObject> &primitiveObjects,
 		activeShader->setUniInt("occlusionUV", occlusionUVSet);
 		activeShader->setUniInt("emissiveUV", emissiveUVSet);
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbos.at(indexAccessor.bufferView));
+		if (primitiveObject.arena.vao != 0) {
+			GeometryArena::draw(primitiveObject.arena, primitive.mode);
+		} else {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, primitiveObject.vbos.at(indexAccessor.bufferView));
 
-		glDrawElements(primitive.mode, indexAccessor.count,
-					indexAccessor.componentType,
-					BUFFER_OFFSET(indexAccessor.byteOffset));
+			glDrawElements(primitive.mode, indexAccessor.count,
+						indexAccessor.componentType,
+						BUFFER_OFFSET(indexAccessor.byteOffset));
+		}
 
 		// Unbind textures we bound (optional)
 		if (baseColorTex >= 0 && baseColorTex < (int)activeTextures.size() && activeTextures[baseColorTex]) activeTextures[baseColorTex]->unbind();
@@ -837,8 +830,6 @@ void ModelEntity::drawMesh(const std::vector<PrimitiveObject> &primitiveObjects,
 		if (normalTexIdx >= 0 && normalTexIdx < (int)activeTextures.size() && activeTextures[normalTexIdx]) activeTextures[normalTexIdx]->unbind();
 		if (occlusionTexIdx >= 0 && occlusionTexIdx < (int)activeTextures.size() && activeTextures[occlusionTexIdx]) activeTextures[occlusionTexIdx]->unbind();
 		if (emissiveTexIdx >= 0 && emissiveTexIdx < (int)activeTextures.size() && activeTextures[emissiveTexIdx]) activeTextures[emissiveTexIdx]->unbind();
-
-		glBindVertexArray(0);
 	}
 }
 
@@ -873,8 +864,11 @@ void ModelEntity::drawModelNodes(const std::vector<PrimitiveObject>& primitiveOb
 void ModelEntity::drawModel(const std::vector<PrimitiveObject>& primitiveObjects,
 				tinygltf::Model &model, std::shared_ptr<Shader> shaderToUse) {
 	// Draw all nodes
+	boundVertexArray = 0;
 	const tinygltf::Scene &scene = model.scenes[model.defaultScene];
 	for (size_t i = 0; i < scene.nodes.size(); ++i) {
 		drawModelNodes(primitiveObjects, model, scene.nodes[i], shaderToUse);
 	}
+	glBindVertexArray(0);
+	boundVertexArray = 0;
 }
@@ -47,6 +47,7 @@ struct ModelEntity : public Entity {
 	std::unordered_map<int, glm::mat4> globalMeshTransforms;
 
 	GLuint jointMatricesID;
+	GLuint boundVertexArray;  // VAO bound by the drawModel() in progress, to skip redundant binds
 
 	ModelEntity();
 
@@ -101,12 +102,14 @@ struct ModelEntity : public Entity {
 	bool loadModel(tinygltf::Model &model, const char *filename);
 
 	void bindMesh(std::vector<PrimitiveObject> &primitiveObjects,
-				tinygltf::Model &model, tinygltf::Mesh &mesh, int nodeIndex);
+				tinygltf::Model &model, tinygltf::Mesh &mesh, int nodeIndex,
+				const std::map<int, GLuint> &vbos);
 
 	void bindModelNodes(
 		std::vector<PrimitiveObject> &primitiveObjects, 
 		tinygltf::Model &model,
-		tinygltf::Node &node
+		tinygltf::Node &node,
+		const std::map<int, GLuint> &vbos
 	);
 
 	std::vector<PrimitiveObject> bindModel(tinygltf::Model &model);
@@ -0,0 +1,52 @@
+#include "ModelLoader.hpp"
+#include <algorithm>
+#include <iostream>
+
+ModelLoader::ModelLoader(unsigned int threadCount)
+    : threadCount(threadCount)
+    , queuedCount(0)
+    , finishedCount(0)
+{
+}
+
+ModelLoader::~ModelLoader() {
+    // Join the workers before the jobs they are preparing go away
+    pool.reset();
+}
+
+void ModelLoader::enqueue(SharedModelResources* resources, bool prepareSkinning, LoadedCallback onLoaded) {
+    if (!pool) pool.reset(new ThreadPool(threadCount));
+
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    job->resources = resources;
+    job->prepareSkinning = prepareSkinning;
+    job->prepared = false;
+    job->onLoaded = onLoaded;
+    queuedCount++;
+
+    pool->enqueue([this, job]() {
+        job->prepared = job->resources->prepare(job->prepareSkinning);
+        std::lock_guard<std::mutex> lock(preparedMutex);
+        preparedJobs.push_back(job);
+    });
+}
+
+void ModelLoader::update(int maxUploads) {
+    std::vector<std::shared_ptr<Job>> ready;
+    {
+        std::lock_guard<std::mutex> lock(preparedMutex);
+        size_t count = std::min(preparedJobs.size(), static_cast<size_t>(std::max(maxUploads, 0)));
+        ready.assign(preparedJobs.begin(), preparedJobs.begin() + count);
+        preparedJobs.erase(preparedJobs.begin(), preparedJobs.begin() + count);
+    }
+
+    for (const std::shared_ptr<Job>& job : ready) {
+        bool ok = job->prepared && job->resources->upload();
+        if (!ok) std::cerr << "[ModelLoader] Failed to load: " << job->resources->modelPath << std::endl;
+        finishedCount++;
+        if (job->onLoaded) job->onLoaded(ok);
+    }
+
+    // Nothing left to prepare, give the threads back
+    if (pool && isFinished()) pool.reset();
+}
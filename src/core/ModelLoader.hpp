@@ -0,0 +1,66 @@
+#ifndef MODELLOADER_HPP
+#define MODELLOADER_HPP
+
+#include "SharedModelResources.hpp"
+#include "ThreadPool.hpp"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Loads SharedModelResources in the background.
+ *
+ * Each queued model runs SharedModelResources::prepare() (glTF parse, image decode, animation data)
+ * on a worker thread; update() on the GL thread then uploads finished models, a few per frame, and calls
+ * their onLoaded callback. The app can keep rendering (terrain, sky, a loading overlay) meanwhile.
+ * The worker threads are released once everything queued has been uploaded.
+ */
+class ModelLoader {
+    public:
+        typedef std::function<void(bool)> LoadedCallback;
+
+        /**
+         * @param threadCount worker threads, 0 picks hardware_concurrency() - 1 (at least 1)
+         */
+        explicit ModelLoader(unsigned int threadCount = 0);
+        ~ModelLoader();
+
+        ModelLoader(ModelLoader const&) = delete;
+        ModelLoader& operator=(ModelLoader const&) = delete;
+
+        /**
+         * @brief Queue resources for loading. onLoaded(success) runs on the GL thread from update().
+         * The resources must not be touched until then.
+         */
+        void enqueue(SharedModelResources* resources, bool prepareSkinning, LoadedCallback onLoaded);
+
+        /**
+         * @brief GL thread: upload up to maxUploads prepared models and run their callbacks
+         */
+        void update(int maxUploads = 1);
+
+        bool isFinished() const { return finishedCount == queuedCount; }
+        int getQueuedCount() const { return queuedCount; }
+        int getFinishedCount() const { return finishedCount; }
+
+    private:
+        struct Job {
+            SharedModelResources* resources;
+            bool prepareSkinning;
+            bool prepared;   // Result of prepare(), written by the worker
+            LoadedCallback onLoaded;
+        };
+
+        unsigned int threadCount;
+        int queuedCount;
+        int finishedCount;
+
+        std::mutex preparedMutex;
+        std::vector<std::shared_ptr<Job>> preparedJobs;
+
+        // Declared last so workers are joined before anything they reference is destroyed
+        std::unique_ptr<ThreadPool> pool;
+};
+
+#endif // MODELLOADER_HPP
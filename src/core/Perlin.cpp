@@ -1,7 +1,57 @@
 #include "Perlin.hpp"
 #include <omp.h>
+#include <random>
+#include <utility>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define PERLIN_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PERLIN_SIMD_WIDTH 4
+#else
+    #define PERLIN_SIMD_WIDTH 1
+#endif
+
+// Ken Perlin's reference permutation, seed 0
+static const uint8_t referencePermutation[256] = {
+    151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
+    8,99, 37,240,21,10,23,190, 6,148,247,120,234,75, 0,26,197,62,94,252,219,203,
+    117, 35,11,32,57,177,33,88,237,149, 56,87,174, 20,125,136,171,168,68,175,74,
+    165,71,134,139, 48,27,166,77,146,158,231,83,111,229,122, 60,211,133,230,220,
+    105,92,41,55,46,245,40,244,102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,
+    187,208, 89,18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,
+    64,52,217,226,250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,
+    47,16,58,17,182,189,28,42,223,183,170,213,119,248,152, 2,44,154,163, 70,221,
+    153,101,155,167,43,172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,
+    112,104,218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241, 81,51,
+    145,235,249,14,239,107,49,192,214,31,181,199,106,157,184,84,204,176,115,121,
+    50,45,127, 4,150,254,138,236,205,93,222,114, 67,29,24,72,243,141,128,195,78,
+    66,215,61,156,180
+};
+
+PerlinNoise::PerlinNoise(int repeat, unsigned int seed, NoiseBasis basis) : repeats(repeat), seed(seed), basis(basis) {
+    uint8_t table[256];
+    for (int i = 0; i < 256; i++) table[i] = referencePermutation[i];
+    if (seed != 0) {
+        // Fisher-Yates driven by mt19937 directly (its output is fully specified, std::shuffle's isn't),
+        // so a seed gives the same world with every standard library
+        std::mt19937 rng(seed);
+        for (int i = 255; i > 0; i--) {
+            int j = static_cast<int>(rng() % static_cast<unsigned int>(i + 1));
+            std::swap(table[i], table[j]);
+        }
+    }
+    for (int i = 0; i < 512; i++) perm[i] = table[i & 255];
+    for (int i = 512; i < 512 + PERMUTATION_PADDING; i++) perm[i] = 0;
+
+    // Tiling wrap tables, so the lattice loops never take a modulo per step
+    repeatMask = (repeats > 0 && (repeats & (repeats - 1)) == 0) ? repeats - 1 : -1;
+    for (int i = 0; i < 256; i++) {
+        nextCell[i] = static_cast<uint16_t>(repeats > 0 ? (i + 1) % repeats : i + 1);
+    }
+}
 
-PerlinNoise::PerlinNoise(int repeat) : repeats(repeat) {};
 float PerlinNoise::fade(float t) {
     // 6t^5 - 15t^4 + 10t^3
     return t * t * t * (t * (t * 6 - 15) + 10);
@@ -18,26 +68,47 @@ float PerlinNoise::grad2D(int hash, float x, float y) {
     }
 }
 
-float PerlinNoise::perlin2D(float x, float y) const {
-    if (repeats > 0) {
-        x = x - repeats * floor(x / repeats); 
-        y = y - repeats * floor(y / repeats);
+/**
+ * @brief Lattice cell of one coordinate: hash index of the cell and of its +1 neighbour, plus the fraction.
+ * Tiled wraps the integer cell into [0, repeats) with a mask (power-of-two periods) or one modulo, and the
+ * neighbour comes from the precomputed nextCell table. The untiled specialisation has no repeat logic at all.
+ */
+template <bool Tiled>
+inline void PerlinNoise::latticeCell(float x, int& i0, int& i1, float& f) const {
+    float fx = floor(x);
+    int xi = static_cast<int>(fx);
+    f = x - fx;
+    if (Tiled) {
+        if (repeatMask >= 0) {
+            xi &= repeatMask;
+        } else {
+            xi %= repeats;
+            if (xi < 0) xi += repeats;
+        }
+        i0 = xi & 255;
+        i1 = nextCell[i0];
+    } else {
+        i0 = xi & 255;
+        i1 = i0 + 1;
     }
+}
 
+template <bool Tiled>
+float PerlinNoise::perlin2DImpl(float x, float y) const {
     // Find unit cell coordinates
-    int xi = static_cast<int>(floor(x)) & 255;
-    int yi = static_cast<int>(floor(y)) & 255;
-    float xf = glm::fract(x);
-    float yf = glm::fract(y);
+    int xi, xi1, yi, yi1;
+    float xf, yf;
+    latticeCell<Tiled>(x, xi, xi1, xf);
+    latticeCell<Tiled>(y, yi, yi1, yf);
     
     // LI weights
     float u = fade(xf);
     float v = fade(yf);
 
-    int aa = p[p[xi] + yi];
-    int ab = p[p[xi] + inc(yi)];
-    int ba = p[p[inc(xi)] + yi];
-    int bb = p[p[inc(xi)] + inc(yi)];
+    int aa = perm[perm[xi] + yi];
+    int ab = perm[perm[xi] + yi1];
+    int ba = perm[perm[xi1] + yi];
+    int bb = perm[perm[xi1] + yi1];
 
     float x1, x2;
     x1 = glm::mix(
@@ -53,39 +124,513 @@ float PerlinNoise::perlin2D(float x, float y) const {
     return (glm::mix(x1, x2, v) + 1) / 2; // Normalize to [0,1]
 }
 
-// TODO: If time allows, implement derivative trick in:
+float PerlinNoise::perlin2D(float x, float y) const {
+    return repeats > 0 ? perlin2DImpl<true>(x, y) : perlin2DImpl<false>(x, y);
+}
+
+// Derivative trick from:
 // https://iquilezles.org/articles/morenoise/
 // https://www.youtube.com/watch?v=gsJHzBTPG0Y
+template <bool Tiled>
+glm::vec3 PerlinNoise::perlin2DDerivativesImpl(float x, float y) const {
+    int xi, xi1, yi, yi1;
+    float xf, yf;
+    latticeCell<Tiled>(x, xi, xi1, xf);
+    latticeCell<Tiled>(y, yi, yi1, yf);
+
+    float u = fade(xf);
+    float v = fade(yf);
+    float du = fadeprime(xf);
+    float dv = fadeprime(yf);
+
+    int aa = perm[perm[xi] + yi];
+    int ab = perm[perm[xi] + yi1];
+    int ba = perm[perm[xi1] + yi];
+    int bb = perm[perm[xi1] + yi1];
+
+    // grad2D(hash, x, y) = gx * x + gy * y with gx, gy = +-1
+    glm::vec2 gaa((aa & 1) ? -1.0f : 1.0f, (aa & 2) ? -1.0f : 1.0f);
+    glm::vec2 gba((ba & 1) ? -1.0f : 1.0f, (ba & 2) ? -1.0f : 1.0f);
+    glm::vec2 gab((ab & 1) ? -1.0f : 1.0f, (ab & 2) ? -1.0f : 1.0f);
+    glm::vec2 gbb((bb & 1) ? -1.0f : 1.0f, (bb & 2) ? -1.0f : 1.0f);
+
+    float naa = gaa.x * xf + gaa.y * yf;
+    float nba = gba.x * (xf - 1) + gba.y * yf;
+    float nab = gab.x * xf + gab.y * (yf - 1);
+    float nbb = gbb.x * (xf - 1) + gbb.y * (yf - 1);
+
+    // n = naa + u (nba - naa) + v (nab - naa) + u v (naa - nba - nab + nbb)
+    float k1 = nba - naa;
+    float k2 = nab - naa;
+    float k3 = naa - nba - nab + nbb;
+    float n = naa + u * k1 + v * k2 + u * v * k3;
+
+    glm::vec2 g1 = gba - gaa;
+    glm::vec2 g2 = gab - gaa;
+    glm::vec2 g3 = gaa - gba - gab + gbb;
+    glm::vec2 d = gaa + u * g1 + v * g2 + u * v * g3
+                + glm::vec2(du * (k1 + v * k3), dv * (k2 + u * k3));
+
+    // Same [0,1] remap as perlin2D
+    return glm::vec3((n + 1) / 2, d.x / 2, d.y / 2);
+}
+
+glm::vec3 PerlinNoise::perlin2DDerivatives(float x, float y) const {
+    return repeats > 0 ? perlin2DDerivativesImpl<true>(x, y) : perlin2DDerivativesImpl<false>(x, y);
+}
+
+
+// Simplex lattice skew/unskew factors for 2D
+static const float SIMPLEX_F2 = 0.36602540378f; // (sqrt(3) - 1) / 2
+static const float SIMPLEX_G2 = 0.21132486540f; // (3 - sqrt(3)) / 6
+// Scales the summed corner contributions to about [-1,1]
+static const float SIMPLEX_SCALE = 70.0f;
+
+// Gradients of the simplex corners, hash & 7 picks one of the 4 diagonals or 4 axes
+static const float SIMPLEX_GRADIENT_X[8] = { 1, -1, 1, -1, 1, -1, 0,  0 };
+static const float SIMPLEX_GRADIENT_Y[8] = { 1,  1, -1, -1, 0,  0, 1, -1 };
+
+static inline glm::vec2 simplexGradient(int hash) {
+    return glm::vec2(SIMPLEX_GRADIENT_X[hash & 7], SIMPLEX_GRADIENT_Y[hash & 7]);
+}
+
+// Skewed cell of (x, y) and the offsets of its 3 corners, shared by both simplex functions
+struct SimplexCell {
+    glm::vec2 d[3];
+    int hash[3];
+};
+
+static inline SimplexCell simplexCell(const uint8_t* perm, float x, float y) {
+    float s = (x + y) * SIMPLEX_F2;
+    float fi = floor(x + s);
+    float fj = floor(y + s);
+    float t = (fi + fj) * SIMPLEX_G2;
+
+    SimplexCell cell;
+    cell.d[0] = glm::vec2(x - (fi - t), y - (fj - t));
+    // Lower or upper triangle of the skewed square
+    int i1 = cell.d[0].x > cell.d[0].y ? 1 : 0;
+    int j1 = 1 - i1;
+    cell.d[1] = cell.d[0] - glm::vec2(static_cast<float>(i1), static_cast<float>(j1)) + SIMPLEX_G2;
+    cell.d[2] = cell.d[0] - 1.0f + 2.0f * SIMPLEX_G2;
+
+    int ii = static_cast<int>(fi) & 255;
+    int jj = static_cast<int>(fj) & 255;
+    cell.hash[0] = perm[ii + perm[jj]];
+    cell.hash[1] = perm[ii + i1 + perm[jj + j1]];
+    cell.hash[2] = perm[ii + 1 + perm[jj + 1]];
+    return cell;
+}
+
+/**
+ * @brief 2D simplex noise in [0,1] (roughly, like perlin2D). Three corners per sample instead of four.
+ * Ignores repeat, the skewed lattice does not tile on square periods.
+ */
+float PerlinNoise::simplex2D(float x, float y) const {
+    SimplexCell cell = simplexCell(perm, x, y);
+    float n = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        // Corners further than sqrt(0.5) contribute nothing, clamped rather than branched on
+        float t = glm::max(0.5f - glm::dot(cell.d[c], cell.d[c]), 0.0f);
+        t *= t;
+        n += t * t * glm::dot(simplexGradient(cell.hash[c]), cell.d[c]);
+    }
+    return (SIMPLEX_SCALE * n + 1) / 2;
+}
+
+glm::vec3 PerlinNoise::simplex2DDerivatives(float x, float y) const {
+    SimplexCell cell = simplexCell(perm, x, y);
+    float n = 0.0f;
+    glm::vec2 d(0.0f);
+    for (int c = 0; c < 3; c++) {
+        float t = glm::max(0.5f - glm::dot(cell.d[c], cell.d[c]), 0.0f);
+        glm::vec2 g = simplexGradient(cell.hash[c]);
+        float gd = glm::dot(g, cell.d[c]);
+        float t2 = t * t;
+        n += t2 * t2 * gd;
+        // d/dp (t^4 (g . p)) with t = 0.5 - p . p
+        d += t2 * t2 * g - 8.0f * t2 * t * gd * cell.d[c];
+    }
+    return glm::vec3((SIMPLEX_SCALE * n + 1) / 2, SIMPLEX_SCALE * d.x / 2, SIMPLEX_SCALE * d.y / 2);
+}
+
+// Corner value of value noise, hash mapped to [-1,1]
+static inline float valueCorner(int hash) {
+    return hash * (2.0f / 255.0f) - 1.0f;
+}
+
+/**
+ * @brief 2D value noise in [0,1]: the 4 corner hashes are the values, blended with the same fade as perlin2D
+ */
+template <bool Tiled>
+float PerlinNoise::value2DImpl(float x, float y) const {
+    int xi, xi1, yi, yi1;
+    float xf, yf;
+    latticeCell<Tiled>(x, xi, xi1, xf);
+    latticeCell<Tiled>(y, yi, yi1, yf);
+    float u = fade(xf);
+    float v = fade(yf);
+
+    float aa = valueCorner(perm[perm[xi] + yi]);
+    float ab = valueCorner(perm[perm[xi] + yi1]);
+    float ba = valueCorner(perm[perm[xi1] + yi]);
+    float bb = valueCorner(perm[perm[xi1] + yi1]);
+
+    return (glm::mix(glm::mix(aa, ba, u), glm::mix(ab, bb, u), v) + 1) / 2;
+}
+
+float PerlinNoise::value2D(float x, float y) const {
+    return repeats > 0 ? value2DImpl<true>(x, y) : value2DImpl<false>(x, y);
+}
+
+template <bool Tiled>
+glm::vec3 PerlinNoise::value2DDerivativesImpl(float x, float y) const {
+    int xi, xi1, yi, yi1;
+    float xf, yf;
+    latticeCell<Tiled>(x, xi, xi1, xf);
+    latticeCell<Tiled>(y, yi, yi1, yf);
+    float u = fade(xf);
+    float v = fade(yf);
+
+    float aa = valueCorner(perm[perm[xi] + yi]);
+    float ab = valueCorner(perm[perm[xi] + yi1]);
+    float ba = valueCorner(perm[perm[xi1] + yi]);
+    float bb = valueCorner(perm[perm[xi1] + yi1]);
+
+    // Same expansion as perlin2DDerivatives, with constant corners
+    float k1 = ba - aa;
+    float k2 = ab - aa;
+    float k3 = aa - ba - ab + bb;
+    float n = aa + u * k1 + v * k2 + u * v * k3;
+    return glm::vec3((n + 1) / 2, fadeprime(xf) * (k1 + v * k3) / 2, fadeprime(yf) * (k2 + u * k3) / 2);
+}
+
+glm::vec3 PerlinNoise::value2DDerivatives(float x, float y) const {
+    return repeats > 0 ? value2DDerivativesImpl<true>(x, y) : value2DDerivativesImpl<false>(x, y);
+}
+
+// noise2D with the tiling decided at compile time, for the octave loops
+template <bool Tiled>
+inline float PerlinNoise::noise2DImpl(float x, float y) const {
+    switch (basis) {
+        case NoiseBasis::Simplex: return simplex2D(x, y);
+        case NoiseBasis::Value: return value2DImpl<Tiled>(x, y);
+        default: return perlin2DImpl<Tiled>(x, y);
+    }
+}
+
+template <bool Tiled>
+inline glm::vec3 PerlinNoise::noise2DDerivativesImpl(float x, float y) const {
+    switch (basis) {
+        case NoiseBasis::Simplex: return simplex2DDerivatives(x, y);
+        case NoiseBasis::Value: return value2DDerivativesImpl<Tiled>(x, y);
+        default: return perlin2DDerivativesImpl<Tiled>(x, y);
+    }
+}
 
+OctaveSchedule::OctaveSchedule(int octaves, float persistence, float lacunarity, float baseFrequency)
+    : octaves(glm::clamp(octaves, 1, MAX_OCTAVES)) {
+    float frequency = baseFrequency;
+    float amplitude = 1;
+    float maxValue = 0;  // Used for normalizing result to [0,1]
+    for (int i = 0; i < this->octaves; i++) {
+        frequencies[i] = frequency;
+        amplitudes[i] = amplitude;
+        maxValue += amplitude;
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+    for (int i = 0; i < this->octaves; i++) {
+        amplitudes[i] /= maxValue;
+    }
+}
+
+/**
+ * @brief octaveNoise for a compile-time octave count, the constant trip count lets the compiler unroll it
+ */
+template <int Octaves, bool Tiled>
+inline float PerlinNoise::octaveNoiseUnrolled(float x, float y, const OctaveSchedule& schedule) const {
+    float total = 0;
+    for (int i = 0; i < Octaves; i++) {
+        total += noise2DImpl<Tiled>(x * schedule.frequencies[i], y * schedule.frequencies[i]) * schedule.amplitudes[i];
+    }
+    return total;
+}
 
 /**
  * @brief noise with multiple samples layered together
  * 
- * @param octaves number of frequency layers
- * @param persistence value between 0 and 1, controlling subsequent amplitude falloff
+ * @param schedule per-octave frequencies and normalised amplitudes
  * @return float 
  */
-float PerlinNoise::octavePerlin(float x, float y, int octaves, float persistence, float lacunarity) const {
+template <bool Tiled>
+float PerlinNoise::octaveNoise(float x, float y, const OctaveSchedule& schedule) const {
+    // The usual octave counts get their own unrolled instantiation
+    switch (schedule.octaves) {
+        case 4: return octaveNoiseUnrolled<4, Tiled>(x, y, schedule);
+        case 5: return octaveNoiseUnrolled<5, Tiled>(x, y, schedule);
+        case 6: return octaveNoiseUnrolled<6, Tiled>(x, y, schedule);
+        case 7: return octaveNoiseUnrolled<7, Tiled>(x, y, schedule);
+        case 8: return octaveNoiseUnrolled<8, Tiled>(x, y, schedule);
+        default: break;
+    }
     float total = 0;
-    float frequency = 1;
-    float amplitude = 1;
-    float maxValue = 0;  // Used for normalizing result to [0,1]
-    
-    for (int i = 0; i < octaves; i++) {
-        total += perlin2D(x * frequency, y * frequency) * amplitude;
+    for (int i = 0; i < schedule.octaves; i++) {
+        total += noise2DImpl<Tiled>(x * schedule.frequencies[i], y * schedule.frequencies[i]) * schedule.amplitudes[i];
+    }
+    return total;
+}
 
-        maxValue += amplitude;
+float PerlinNoise::octavePerlin(float x, float y, const OctaveSchedule& schedule) const {
+    // Tiling is decided once here, not per lattice step
+    return repeats > 0 ? octaveNoise<true>(x, y, schedule) : octaveNoise<false>(x, y, schedule);
+}
 
-        amplitude *= persistence;
-        frequency *= lacunarity;
+float PerlinNoise::octavePerlin(float x, float y, int octaves, float persistence, float lacunarity) const {
+    return octavePerlin(x, y, OctaveSchedule(octaves, persistence, lacunarity));
+}
+
+/**
+ * @brief octavePerlin plus its gradient, evaluated in the same pass
+ * 
+ * @return glm::vec3 (noise, d noise/dx, d noise/dy)
+ */
+template <bool Tiled>
+glm::vec3 PerlinNoise::octaveNoiseWithDerivatives(float x, float y, const OctaveSchedule& schedule) const {
+    glm::vec3 total(0.0f);
+    for (int i = 0; i < schedule.octaves; i++) {
+        float frequency = schedule.frequencies[i];
+        glm::vec3 n = noise2DDerivativesImpl<Tiled>(x * frequency, y * frequency);
+        // Chain rule: the octave is sampled at frequency * (x, y)
+        total += glm::vec3(n.x, n.y * frequency, n.z * frequency) * schedule.amplitudes[i];
+    }
+    return total;
+}
+
+glm::vec3 PerlinNoise::octavePerlinWithDerivatives(float x, float y, const OctaveSchedule& schedule) const {
+    return repeats > 0 ? octaveNoiseWithDerivatives<true>(x, y, schedule) : octaveNoiseWithDerivatives<false>(x, y, schedule);
+}
+
+glm::vec3 PerlinNoise::octavePerlinWithDerivatives(float x, float y, int octaves, float persistence, float lacunarity) const {
+    return octavePerlinWithDerivatives(x, y, OctaveSchedule(octaves, persistence, lacunarity));
+}
+
+#if PERLIN_SIMD_WIDTH == 8
+// 8 samples of perlin2D (non-tiling). Same math as the scalar version:
+// the gradient sign flips are XORs of the hash bits into the float sign bit, so there are no branches.
+// The table is bytes: each gather reads 32 bits at the entry (hence PERMUTATION_PADDING) and keeps the low 8.
+static inline __m256i gatherPermutation8(const uint8_t* p, __m256i index) {
+    return _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(p), index, 1), _mm256_set1_epi32(255));
+}
+
+static inline __m256 perlin2D8(const uint8_t* p, __m256 x, __m256 y) {
+    const __m256i mask255 = _mm256_set1_epi32(255);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    __m256 fx = _mm256_floor_ps(x);
+    __m256 fy = _mm256_floor_ps(y);
+    __m256i xi = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask255);
+    __m256i yi = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask255);
+    __m256 xf = _mm256_sub_ps(x, fx);
+    __m256 yf = _mm256_sub_ps(y, fy);
+
+    // fade(t) = t^3 (t (6t - 15) + 10)
+    const __m256 six = _mm256_set1_ps(6.0f), fifteen = _mm256_set1_ps(15.0f), ten = _mm256_set1_ps(10.0f);
+    __m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(xf, xf), xf),
+        _mm256_add_ps(_mm256_mul_ps(xf, _mm256_sub_ps(_mm256_mul_ps(xf, six), fifteen)), ten));
+    __m256 v = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(yf, yf), yf),
+        _mm256_add_ps(_mm256_mul_ps(yf, _mm256_sub_ps(_mm256_mul_ps(yf, six), fifteen)), ten));
+
+    __m256i px0 = gatherPermutation8(p, xi);
+    __m256i px1 = gatherPermutation8(p, _mm256_add_epi32(xi, one));
+    __m256i yi1 = _mm256_add_epi32(yi, one);
+    __m256i aa = gatherPermutation8(p, _mm256_add_epi32(px0, yi));
+    __m256i ab = gatherPermutation8(p, _mm256_add_epi32(px0, yi1));
+    __m256i ba = gatherPermutation8(p, _mm256_add_epi32(px1, yi));
+    __m256i bb = gatherPermutation8(p, _mm256_add_epi32(px1, yi1));
+
+    const __m256 oneF = _mm256_set1_ps(1.0f);
+    __m256 xf1 = _mm256_sub_ps(xf, oneF);
+    __m256 yf1 = _mm256_sub_ps(yf, oneF);
+    // grad2D: hash bit 0 negates x, bit 1 negates y
+    #define PERLIN_GRAD8(h, gx, gy) _mm256_add_ps( \
+        _mm256_xor_ps(gx, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, one), 31))), \
+        _mm256_xor_ps(gy, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30))))
+    __m256 gaa = PERLIN_GRAD8(aa, xf, yf);
+    __m256 gba = PERLIN_GRAD8(ba, xf1, yf);
+    __m256 gab = PERLIN_GRAD8(ab, xf, yf1);
+    __m256 gbb = PERLIN_GRAD8(bb, xf1, yf1);
+    #undef PERLIN_GRAD8
+
+    __m256 x1 = _mm256_add_ps(gaa, _mm256_mul_ps(u, _mm256_sub_ps(gba, gaa)));
+    __m256 x2 = _mm256_add_ps(gab, _mm256_mul_ps(u, _mm256_sub_ps(gbb, gab)));
+    __m256 n = _mm256_add_ps(x1, _mm256_mul_ps(v, _mm256_sub_ps(x2, x1)));
+    return _mm256_mul_ps(_mm256_add_ps(n, oneF), _mm256_set1_ps(0.5f));
+}
+#elif PERLIN_SIMD_WIDTH == 4
+// 4 samples of perlin2D (non-tiling), SSE2 only: floor by truncation + fix-up, table lookups done per lane
+static inline __m128 perlin2D4(const uint8_t* p, __m128 x, __m128 y) {
+    const __m128 oneF = _mm_set1_ps(1.0f);
+    __m128 tx = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    __m128 ty = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+    __m128 fx = _mm_sub_ps(tx, _mm_and_ps(_mm_cmpgt_ps(tx, x), oneF));
+    __m128 fy = _mm_sub_ps(ty, _mm_and_ps(_mm_cmpgt_ps(ty, y), oneF));
+    __m128 xf = _mm_sub_ps(x, fx);
+    __m128 yf = _mm_sub_ps(y, fy);
+
+    const __m128 six = _mm_set1_ps(6.0f), fifteen = _mm_set1_ps(15.0f), ten = _mm_set1_ps(10.0f);
+    __m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(xf, xf), xf),
+        _mm_add_ps(_mm_mul_ps(xf, _mm_sub_ps(_mm_mul_ps(xf, six), fifteen)), ten));
+    __m128 v = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(yf, yf), yf),
+        _mm_add_ps(_mm_mul_ps(yf, _mm_sub_ps(_mm_mul_ps(yf, six), fifteen)), ten));
+
+    alignas(16) int xi[4], yi[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(xi), _mm_cvttps_epi32(fx));
+    _mm_store_si128(reinterpret_cast<__m128i*>(yi), _mm_cvttps_epi32(fy));
+    alignas(16) int aa[4], ab[4], ba[4], bb[4];
+    for (int i = 0; i < 4; i++) {
+        int x0 = xi[i] & 255, y0 = yi[i] & 255;
+        int px0 = p[x0], px1 = p[x0 + 1];
+        aa[i] = p[px0 + y0];
+        ab[i] = p[px0 + y0 + 1];
+        ba[i] = p[px1 + y0];
+        bb[i] = p[px1 + y0 + 1];
+    }
+
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    __m128 xf1 = _mm_sub_ps(xf, oneF);
+    __m128 yf1 = _mm_sub_ps(yf, oneF);
+    #define PERLIN_GRAD4(hArr, gx, gy) _mm_add_ps( \
+        _mm_xor_ps(gx, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(hArr)), one), 31))), \
+        _mm_xor_ps(gy, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(hArr)), two), 30))))
+    __m128 gaa = PERLIN_GRAD4(aa, xf, yf);
+    __m128 gba = PERLIN_GRAD4(ba, xf1, yf);
+    __m128 gab = PERLIN_GRAD4(ab, xf, yf1);
+    __m128 gbb = PERLIN_GRAD4(bb, xf1, yf1);
+    #undef PERLIN_GRAD4
+
+    __m128 x1 = _mm_add_ps(gaa, _mm_mul_ps(u, _mm_sub_ps(gba, gaa)));
+    __m128 x2 = _mm_add_ps(gab, _mm_mul_ps(u, _mm_sub_ps(gbb, gab)));
+    __m128 n = _mm_add_ps(x1, _mm_mul_ps(v, _mm_sub_ps(x2, x1)));
+    return _mm_mul_ps(_mm_add_ps(n, oneF), _mm_set1_ps(0.5f));
+}
+#endif
+
+void PerlinNoise::noise2DBatch(const float* xs, const float* ys, float* out, int count) const {
+    int i = 0;
+#if PERLIN_SIMD_WIDTH == 8
+    if (repeats <= 0 && basis == NoiseBasis::Perlin) {
+        for (; i + 8 <= count; i += 8) {
+            _mm256_storeu_ps(out + i, perlin2D8(perm, _mm256_loadu_ps(xs + i), _mm256_loadu_ps(ys + i)));
+        }
     }
+#elif PERLIN_SIMD_WIDTH == 4
+    if (repeats <= 0 && basis == NoiseBasis::Perlin) {
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(out + i, perlin2D4(perm, _mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i)));
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = noise2D(xs[i], ys[i]);
+    }
+}
+
+void PerlinNoise::octavePerlinBatch(const float* xs, const float* ys, float* out, int count,
+                                    const OctaveSchedule& schedule) const {
+    // Work in blocks so the scaled coordinates stay on the stack
+    const int BLOCK = 256;
+    float bx[BLOCK], by[BLOCK], bn[BLOCK];
+
+    for (int start = 0; start < count; start += BLOCK) {
+        const int n = glm::min(BLOCK, count - start);
+        float* total = out + start;
+        for (int i = 0; i < n; i++) total[i] = 0.0f;
+
+        for (int o = 0; o < schedule.octaves; o++) {
+            const float frequency = schedule.frequencies[o];
+            const float amplitude = schedule.amplitudes[o];
+            for (int i = 0; i < n; i++) {
+                bx[i] = xs[start + i] * frequency;
+                by[i] = ys[start + i] * frequency;
+            }
+            noise2DBatch(bx, by, bn, n);
+            for (int i = 0; i < n; i++) {
+                total[i] += bn[i] * amplitude;
+            }
+        }
+    }
+}
+
+void PerlinNoise::octavePerlinBatch(const float* xs, const float* ys, float* out, int count,
+                                    int octaves, float persistence, float lacunarity, float baseFrequency) const {
+    octavePerlinBatch(xs, ys, out, count, OctaveSchedule(octaves, persistence, lacunarity, baseFrequency));
+}
+
+void PerlinNoise::octavePerlinGrid(float x0, float y0, float step, int width, int height, float* out,
+                                   const OctaveSchedule& schedule) const {
+    if (repeats > 0 || basis != NoiseBasis::Perlin) {
+        // The tiled lattice wraps mid-row and the other bases have their own lattices, keep it simple
+        for (int r = 0; r < height; r++) {
+            for (int c = 0; c < width; c++) {
+                out[c + r * width] = octavePerlin(x0 + c * step, y0 + r * step, schedule);
+            }
+        }
+        return;
+    }
+
+    // Rows outermost so a row stays in cache across its octaves
+    for (int r = 0; r < height; r++) {
+        float* row = out + r * width;
+        for (int c = 0; c < width; c++) row[c] = 0.0f;
+
+        for (int o = 0; o < schedule.octaves; o++) {
+            const float frequency = schedule.frequencies[o];
+            const float halfAmplitude = 0.5f * schedule.amplitudes[o];
+            // Everything that only depends on y
+            float y = (y0 + r * step) * frequency;
+            float fy = floor(y);
+            int yi = static_cast<int>(fy) & 255;
+            float yf = y - fy;
+            float v = fade(yf);
+
+            // Current lattice cell [cellStart, cellEnd)
+            float cellStart = 0.0f;
+            float cellEnd = 0.0f;
+            // Within a cell the y-mixed gradients are linear in xf: left = Lx * xf + L0, right = Rx * (xf - 1) + R0
+            float Lx = 0, L0 = 0, Rx = 0, R0 = 0;
+            for (int c = 0; c < width; c++) {
+                float x = (x0 + c * step) * frequency;
+                if (c == 0 || x >= cellEnd || x < cellStart) {
+                    cellStart = floor(x);
+                    cellEnd = cellStart + 1.0f;
+                    int xi = static_cast<int>(cellStart) & 255;
+                    int aa = perm[perm[xi] + yi];
+                    int ab = perm[perm[xi] + yi + 1];
+                    int ba = perm[perm[xi + 1] + yi];
+                    int bb = perm[perm[xi + 1] + yi + 1];
+                    // grad2D(hash, x, y): bit 0 negates x, bit 1 negates y
+                    Lx = (1 - v) * ((aa & 1) ? -1.0f : 1.0f) + v * ((ab & 1) ? -1.0f : 1.0f);
+                    L0 = (1 - v) * ((aa & 2) ? -yf : yf) + v * ((ab & 2) ? -(yf - 1) : (yf - 1));
+                    Rx = (1 - v) * ((ba & 1) ? -1.0f : 1.0f) + v * ((bb & 1) ? -1.0f : 1.0f);
+                    R0 = (1 - v) * ((ba & 2) ? -yf : yf) + v * ((bb & 2) ? -(yf - 1) : (yf - 1));
+                }
+                float xf = x - cellStart;
+                float u = fade(xf);
+                float left = Lx * xf + L0;
+                float right = Rx * (xf - 1) + R0;
+                row[c] += (left + u * (right - left) + 1) * halfAmplitude;
+            }
+        }
+    }
+}
 
-    return total / maxValue;
+void PerlinNoise::octavePerlinGrid(float x0, float y0, float step, int width, int height, float* out,
+                                   int octaves, float persistence, float lacunarity, float baseFrequency) const {
+    octavePerlinGrid(x0, y0, step, width, height, out, OctaveSchedule(octaves, persistence, lacunarity, baseFrequency));
 }
 
-// For handling repeated noise patterns
+// For handling repeated noise patterns: the next lattice index, wrapped to the tile period
 int PerlinNoise::inc(int num) const {
-    num++;
-    if (repeats > 0) num = num % repeats;
-    return num;
+    return nextCell[num & 255];
 }
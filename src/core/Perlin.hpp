@@ -1,13 +1,38 @@
 #ifndef PERLIN_HPP
 #define PERLIN_HPP
 
+#include <cstdint>
 #include <glm/glm.hpp>
 
+// Lattice noise PerlinNoise evaluates, every basis returns roughly [0,1]
+enum class NoiseBasis {
+    Perlin,   // Gradient noise on the square lattice, 4 corners (the original terrain)
+    Simplex,  // Gradient noise on the skewed triangle lattice, 3 corners, no axis-aligned artifacts
+    Value     // Hashed corner values on the square lattice, 4 corners, cheapest but blobbier
+};
+
+/**
+ * @brief Frequencies and amplitudes of every octave, with the [0,1] normalisation folded into the amplitudes.
+ * Build one when the octave parameters change, not per sample.
+ */
+struct OctaveSchedule {
+    static const int MAX_OCTAVES = 32;
+
+    int octaves;
+    float frequencies[MAX_OCTAVES]; // baseFrequency * lacunarity^i
+    float amplitudes[MAX_OCTAVES];  // persistence^i / sum of all persistence^i
+
+    OctaveSchedule(int octaves = 5, float persistence = 0.503f, float lacunarity = 2.0f, float baseFrequency = 1.0f);
+};
 
 class PerlinNoise {
 
     public:
-        PerlinNoise(int repeat = -1);
+        /**
+         * @param repeat tile period in lattice cells, -1 for no tiling (Perlin and Value bases only)
+         * @param seed 0 keeps Ken Perlin's reference permutation, anything else shuffles it deterministically
+         */
+        PerlinNoise(int repeat = -1, unsigned int seed = 0, NoiseBasis basis = NoiseBasis::Perlin);
         static float fade(float t);
         static float fadeprime(float t) {
             // 30 t^4 - 60 t^3 + 30 t^2
@@ -18,42 +43,88 @@ class PerlinNoise {
         int inc(int num) const;
 
         float perlin2D(float x, float y) const;
-        // glm::vec3 perlin2DDerivatives(float x, float y) const;
+        // (noise, d noise/dx, d noise/dy), noise in [0,1] like perlin2D
+        glm::vec3 perlin2DDerivatives(float x, float y) const;
+        float simplex2D(float x, float y) const;
+        glm::vec3 simplex2DDerivatives(float x, float y) const;
+        float value2D(float x, float y) const;
+        glm::vec3 value2DDerivatives(float x, float y) const;
+
+        // One sample of the selected basis
+        float noise2D(float x, float y) const {
+            switch (basis) {
+                case NoiseBasis::Simplex: return simplex2D(x, y);
+                case NoiseBasis::Value: return value2D(x, y);
+                default: return perlin2D(x, y);
+            }
+        }
+        glm::vec3 noise2DDerivatives(float x, float y) const {
+            switch (basis) {
+                case NoiseBasis::Simplex: return simplex2DDerivatives(x, y);
+                case NoiseBasis::Value: return value2DDerivatives(x, y);
+                default: return perlin2DDerivatives(x, y);
+            }
+        }
+
+        // The octave functions layer noise2D, i.e. whichever basis is selected.
+        // Prefer the OctaveSchedule overloads in loops, the others build a schedule per call.
+        float octavePerlin(float x, float y, const OctaveSchedule& schedule) const;
         float octavePerlin(float x, float y, int octaves, float persistence, float lacunarity) const;
-        
+        // (octavePerlin, d/dx, d/dy) in one pass
+        glm::vec3 octavePerlinWithDerivatives(float x, float y, const OctaveSchedule& schedule) const;
+        glm::vec3 octavePerlinWithDerivatives(float x, float y, int octaves, float persistence, float lacunarity) const;
+
+        // Batch versions: out[i] = noise2D(xs[i], ys[i]). AVX2 (8 lanes) or SSE2 (4 lanes) when the build
+        // targets them, scalar otherwise and for the remainder. Only the non-tiling Perlin basis is vectorised.
+        void noise2DBatch(const float* xs, const float* ys, float* out, int count) const;
+        // out[i] = octavePerlin(xs[i], ys[i], schedule)
+        void octavePerlinBatch(const float* xs, const float* ys, float* out, int count, const OctaveSchedule& schedule) const;
+        // out[i] = octavePerlin(xs[i] * baseFrequency, ys[i] * baseFrequency, ...)
+        void octavePerlinBatch(const float* xs, const float* ys, float* out, int count,
+                               int octaves, float persistence, float lacunarity, float baseFrequency = 1.0f) const;
+
+        /**
+         * @brief octavePerlin over a regular grid: out[c + r * width] at (x0 + c * step, y0 + r * step) * baseFrequency.
+         * Walks each row once per octave, reusing the row's y hash/fade terms and only rehashing the
+         * corners when x crosses into a new lattice cell. Serial, callers parallelise over rows.
+         * Other bases (and tiling) fall back to octavePerlin per sample.
+         * The schedule overload samples at (x0 + c * step, y0 + r * step), its frequencies include any base frequency.
+         */
+        void octavePerlinGrid(float x0, float y0, float step, int width, int height, float* out,
+                              const OctaveSchedule& schedule) const;
+        void octavePerlinGrid(float x0, float y0, float step, int width, int height, float* out,
+                              int octaves, float persistence, float lacunarity, float baseFrequency = 1.0f) const;
+
+        // Entry of the (doubled) permutation table, e.g. for uploading it to the GPU
+        int getPermutation(int i) const { return perm[i & 511]; }
+        unsigned int getSeed() const { return seed; }
+        NoiseBasis getBasis() const { return basis; }
+        void setBasis(NoiseBasis basis) { this->basis = basis; }
+
+        // Bytes after the doubled table, so the AVX2 path can gather 32 bits at any index
+        static const int PERMUTATION_PADDING = 4;
 
         private:
-        // Ken Perlin's hash lookup table, but doubled
-        static constexpr int p[512] = {
-            151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
-            8,99, 37,240,21,10,23,190, 6,148,247,120,234,75, 0,26,197,62,94,252,219,203,
-            117, 35,11,32,57,177,33,88,237,149, 56,87,174, 20,125,136,171,168,68,175,74,
-            165,71,134,139, 48,27,166,77,146,158,231,83,111,229,122, 60,211,133,230,220,
-            105,92,41,55,46,245,40,244,102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,
-            187,208, 89,18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,
-            64,52,217,226,250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,
-            47,16,58,17,182,189,28,42,223,183,170,213,119,248,152, 2,44,154,163, 70,221,
-            153,101,155,167,43,172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,
-            112,104,218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241, 81,51,
-            145,235,249,14,239,107,49,192,214,31,181,199,106,157,184,84,204,176,115,121,
-            50,45,127, 4,150,254,138,236,205,93,222,114, 67,29,24,72,243,141,128,195,78,
-            66,215,61,156,180,
-            151,160,137,91,90,15,131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,
-            8,99, 37,240,21,10,23,190, 6,148,247,120,234,75, 0,26,197,62,94,252,219,203,
-            117, 35,11,32,57,177,33,88,237,149, 56,87,174, 20,125,136,171,168,68,175,74,
-            165,71,134,139, 48,27,166,77,146,158,231,83,111,229,122, 60,211,133,230,220,
-            105,92,41,55,46,245,40,244,102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,
-            187,208, 89,18,169,200,196,135,130,116,188,159,86,164,100,109,198,173,186,3,
-            64,52,217,226,250,124,123,5,202,38,147,118,126,255,82,85,212,207,206,59,227,
-            47,16,58,17,182,189,28,42,223,183,170,213,119,248,152, 2,44,154,163, 70,221,
-            153,101,155,167,43,172,9,129,22,39,253,19,98,108,110,79,113,224,232,178,185,
-            112,104,218,246,97,228,251,34,242,193,238,210,144,12,191,179,162,241, 81,51,
-            145,235,249,14,239,107,49,192,214,31,181,199,106,157,184,84,204,176,115,121,
-            50,45,127, 4,150,254,138,236,205,93,222,114, 67,29,24,72,243,141,128,195,78,
-            66,215,61,156,180
-        };
+        // Seeded shuffle of Ken Perlin's hash lookup table, doubled so perm[perm[x] + y] never wraps
+        uint8_t perm[512 + PERMUTATION_PADDING];
 
         int repeats;
+        int repeatMask;          // repeats - 1 when repeats is a power of two, else -1
+        uint16_t nextCell[256];  // Index of the next lattice cell, (i + 1) % repeats when tiling
+        unsigned int seed;
+        NoiseBasis basis;
+
+        // Tiled selects the repeating lattice at compile time, the public functions pick one per call
+        template <bool Tiled> void latticeCell(float x, int& i0, int& i1, float& f) const;
+        template <bool Tiled> float perlin2DImpl(float x, float y) const;
+        template <bool Tiled> glm::vec3 perlin2DDerivativesImpl(float x, float y) const;
+        template <bool Tiled> float value2DImpl(float x, float y) const;
+        template <bool Tiled> glm::vec3 value2DDerivativesImpl(float x, float y) const;
+        template <bool Tiled> float noise2DImpl(float x, float y) const;
+        template <bool Tiled> glm::vec3 noise2DDerivativesImpl(float x, float y) const;
+        template <bool Tiled> float octaveNoise(float x, float y, const OctaveSchedule& schedule) const;
+        template <int Octaves, bool Tiled> float octaveNoiseUnrolled(float x, float y, const OctaveSchedule& schedule) const;
+        template <bool Tiled> glm::vec3 octaveNoiseWithDerivatives(float x, float y, const OctaveSchedule& schedule) const;
 };
 
 
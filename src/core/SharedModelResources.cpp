@@ -1,17 +1,25 @@
 #include "SharedModelResources.hpp"
+#include "CookedModel.hpp"
+#include "GeometryArena.hpp"
+#include "ModelBuffers.hpp"
 
 bool SharedModelResources::load(bool prepareSkinningData) {
     if (loaded) {
         std::cout << "[SharedModelResources] Already loaded: " << modelPath << std::endl;
         return true;
     }
+    if (!prepared && !prepare(prepareSkinningData)) return false;
+    return upload();
+}
+
+bool SharedModelResources::prepare(bool prepareSkinningData) {
+    if (prepared) return true;
 
     std::cout << "[SharedModelResources] Loading: " << modelPath << std::endl;
 
-    // Load the glTF model
-    tinygltf::TinyGLTF loader;
+    // Load the glTF model (its cooked copy when there is one)
     std::string err, warn;
-    bool res = loader.LoadASCIIFromFile(&model, &err, &warn, modelPath.c_str());
+    bool res = CookedModel::load(modelPath, model, err, warn);
     
     if (!warn.empty()) std::cout << "WARN: " << warn << std::endl;
     if (!err.empty()) std::cout << "ERR: " << err << std::endl;
@@ -20,18 +28,15 @@ bool SharedModelResources::load(bool prepareSkinningData) {
         return false;
     }
 
-    // Compile shader
-    shader = std::make_shared<Shader>(vertexShaderPath.c_str(), fragmentShaderPath.c_str());
-    if (shader->getProgramID() == 0) {
-        std::cerr << "[SharedModelResources] Failed to compile shader for: " << modelPath << std::endl;
-        return false;
+    // Pixels tinygltf decoded while parsing are never used, textures are decoded from their files below
+    size_t imageBytes = releaseModelImageData(model);
+    if (imageBytes > 0) {
+        std::cout << "[SharedModelResources] " << modelPath << ": released " << imageBytes / 1024
+                  << " KB of decoded glTF images" << std::endl;
     }
 
-    // Bind VAOs/VBOs
-    bindModelBuffers();
-
-    // Load textures
-    loadTextures();
+    // Decode textures
+    decodeTextures();
 
     // Compute static transforms
     computeStaticTransforms();
@@ -42,26 +47,48 @@ bool SharedModelResources::load(bool prepareSkinningData) {
         prepareAnimationData();
     }
 
+    prepared = true;
+    return true;
+}
+
+bool SharedModelResources::upload() {
+    if (loaded) return true;
+    if (!prepared) {
+        std::cerr << "[SharedModelResources] upload() before prepare(): " << modelPath << std::endl;
+        return false;
+    }
+
+    // Compile shader
+    shader = std::make_shared<Shader>(vertexShaderPath.c_str(), fragmentShaderPath.c_str());
+    if (shader->getProgramID() == 0) {
+        std::cerr << "[SharedModelResources] Failed to compile shader for: " << modelPath << std::endl;
+        return false;
+    }
+
+    // Bind VAOs/VBOs
+    bindModelBuffers();
+
+    // Geometry is on the GPU and skin/animation data was copied out in prepare(),
+    // only the metadata (nodes, meshes, accessors, materials) is still read
+    size_t bufferBytes = releaseModelBufferData(model);
+    std::cout << "[SharedModelResources] " << modelPath << ": released " << bufferBytes / 1024
+              << " KB of glTF buffer data" << std::endl;
+
+    // Upload textures
+    uploadTextures();
+
     loaded = true;
     std::cout << "[SharedModelResources] Loaded successfully: " << modelPath << std::endl;
     return true;
 }
 
 void SharedModelResources::bindModelBuffers() {
-    // Create VBOs for all buffer views
-    std::map<int, GLuint> vbos;
-    for (size_t i = 0; i < model.bufferViews.size(); ++i) {
-        const tinygltf::BufferView &bufferView = model.bufferViews[i];
-        int target = bufferView.target;
-        const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
-        
-        GLuint vbo;
-        glGenBuffers(1, &vbo);
-        glBindBuffer(target, vbo);
-        glBufferData(target, bufferView.byteLength,
-                    &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-        vbos[i] = vbo;
-    }
+    // Geometry goes into the shared GeometryArena. Primitives it can't pack (e.g. without indices)
+    // fall back to their own VAO over per-bufferView VBOs, uploaded only if needed.
+    ModelGPUBuffers buffers;
+    bool buffersUploaded = false;
+    std::map<std::pair<int, int>, ArenaGeometry> packed; // (mesh, primitive) -> arena range, for meshes used by several nodes
+    int arenaPrimitives = 0, fallbackPrimitives = 0;
 
     // Recursively bind all mesh nodes
     const tinygltf::Scene &scene = model.scenes[model.defaultScene];
@@ -75,6 +102,30 @@ void SharedModelResources::bindModelBuffers() {
             for (size_t i = 0; i < mesh.primitives.size(); ++i) {
                 tinygltf::Primitive &primitive = mesh.primitives[i];
 
+                PrimitiveObject primitiveObject;
+                primitiveObject.meshIndex = node.mesh;
+                primitiveObject.primitiveIndex = i;
+
+                std::pair<int, int> key(node.mesh, (int)i);
+                std::map<std::pair<int, int>, ArenaGeometry>::iterator it = packed.find(key);
+                if (it == packed.end()) {
+                    ArenaGeometry geometry;
+                    if (GeometryArena::add(model, primitive, geometry)) it = packed.insert(std::make_pair(key, geometry)).first;
+                }
+                if (it != packed.end()) {
+                    primitiveObject.vao = it->second.vao;
+                    primitiveObject.arena = it->second;
+                    primitives.push_back(primitiveObject);
+                    arenaPrimitives++;
+                    continue;
+                }
+
+                if (!buffersUploaded) {
+                    buffers = uploadModelBuffers(model);
+                    buffersUploaded = true;
+                }
+                std::map<int, GLuint> &vbos = buffers.vbos;
+
                 GLuint vao;
                 glGenVertexArrays(1, &vao);
                 glBindVertexArray(vao);
@@ -89,16 +140,7 @@ void SharedModelResources::bindModelBuffers() {
                         size = accessor.type;
                     }
 
-                    int vaa = -1;
-                    if (attrib.first == "POSITION") vaa = 0;
-                    else if (attrib.first == "NORMAL") vaa = 1;
-                    else if (attrib.first == "TEXCOORD_0") vaa = 2;
-                    else if (attrib.first == "JOINTS_0") vaa = 3;
-                    else if (attrib.first == "WEIGHTS_0") vaa = 4;
-                    else if (attrib.first == "TANGENT") vaa = 5;
-                    else if (attrib.first == "TEXCOORD_1") vaa = 6;
-                    else if (attrib.first == "TEXCOORD_2") vaa = 7;
-                    
+                    int vaa = GeometryArena::attributeLocation(attrib.first);
                     if (vaa > -1) {
                         glEnableVertexAttribArray(vaa);
                         glVertexAttribPointer(vaa, size, accessor.componentType,
@@ -107,12 +149,10 @@ void SharedModelResources::bindModelBuffers() {
                     }
                 }
 
-                PrimitiveObject primitiveObject;
                 primitiveObject.vao = vao;
                 primitiveObject.vbos = vbos;
-                primitiveObject.meshIndex = node.mesh;
-                primitiveObject.primitiveIndex = i;
                 primitives.push_back(primitiveObject);
+                fallbackPrimitives++;
 
                 glBindVertexArray(0);
             }
@@ -126,25 +166,41 @@ void SharedModelResources::bindModelBuffers() {
     for (int rootNode : scene.nodes) {
         bindNode(rootNode);
     }
+
+    std::cout << "[SharedModelResources] " << modelPath << ": " << arenaPrimitives << " primitives in the geometry arena ("
+              << GeometryArena::getVertexBytes() / 1024 << " KB vertices, " << GeometryArena::getIndexBytes() / 1024
+              << " KB indices in " << GeometryArena::getLayoutCount() << " layouts so far)";
+    if (fallbackPrimitives > 0) {
+        std::cout << ", " << fallbackPrimitives << " with their own VAO (" << buffers.uploadedBytes / 1024 << " KB)";
+    }
+    std::cout << std::endl;
 }
 
-void SharedModelResources::loadTextures() {
-    textures.clear();
+void SharedModelResources::decodeTextures() {
+    decodedTextures.clear();
+    decodedTextures.resize(model.textures.size());
     for (size_t ti = 0; ti < model.textures.size(); ++ti) {
         int source = model.textures[ti].source;
-        if (source < 0 || source >= (int)model.images.size()) {
-            textures.push_back(nullptr);
-            continue;
-        }
+        if (source < 0 || source >= (int)model.images.size()) continue;
         const tinygltf::Image &img = model.images[source];
         if (!img.uri.empty()) {
             std::string imagePath = modelDirectory + img.uri;
-            auto tex = std::make_shared<Texture>(imagePath.c_str(), "tex", (GLuint)ti, GL_RGBA, GL_UNSIGNED_BYTE);
-            textures.push_back(tex);
+            Texture::decode(imagePath.c_str(), decodedTextures[ti]);
+        }
+    }
+}
+
+void SharedModelResources::uploadTextures() {
+    textures.clear();
+    for (size_t ti = 0; ti < decodedTextures.size(); ++ti) {
+        if (decodedTextures[ti].pixels) {
+            textures.push_back(std::make_shared<Texture>(decodedTextures[ti], "tex", (GLuint)ti));
         } else {
             textures.push_back(nullptr);
         }
     }
+    // The pixels live on the GPU now
+    decodedTextures.clear();
 }
 
 glm::mat4 SharedModelResources::getNodeTransform(const tinygltf::Node& node) const {
@@ -32,6 +32,10 @@
  * 
  * This includes the glTF model, compiled shader, VAOs/VBOs, textures, and precomputed transforms.
  * Call load() once before creating any instances that use this resource.
+ *
+ * Loading is split in two so it can happen in the background (see ModelLoader):
+ * prepare() parses the glTF, decodes the images and computes transforms/animation data without GL,
+ * upload() then creates the shader, buffers and textures on the GL thread. load() does both.
  */
 struct SharedModelResources {
     // Resource paths
@@ -41,6 +45,7 @@ struct SharedModelResources {
     std::string fragmentShaderPath;
 
     // Loaded state
+    bool prepared = false;
     bool loaded = false;
 
     // Shared GPU resources
@@ -48,6 +53,8 @@ struct SharedModelResources {
     tinygltf::Model model;
     std::vector<PrimitiveObject> primitives;
     std::vector<std::shared_ptr<Texture>> textures;
+    // Decoded images per model.textures entry, from prepare() until upload() (null pixels = no texture)
+    std::vector<TextureImage> decodedTextures;
     
     // Precomputed static transforms (for non-animated models)
     std::unordered_map<int, glm::mat4> localMeshTransforms;
@@ -67,6 +74,7 @@ struct SharedModelResources {
         , modelPath(modelFile)
         , vertexShaderPath(vertShader)
         , fragmentShaderPath(fragShader)
+        , prepared(false)
         , loaded(false)
     {}
 
@@ -77,6 +85,17 @@ struct SharedModelResources {
      */
     bool load(bool prepareSkinning = false);
 
+    /**
+     * @brief CPU half of load(): parse the model, decode textures, compute transforms and animation data.
+     * Makes no GL calls, so it may run on a worker thread (but only one thread per resource).
+     */
+    bool prepare(bool prepareSkinning = false);
+
+    /**
+     * @brief GL half of load(): compile the shader, upload buffers and textures. GL thread only, after prepare().
+     */
+    bool upload();
+
     /**
      * @brief Check if resources are loaded
      */
@@ -84,7 +103,8 @@ struct SharedModelResources {
 
 private:
     void bindModelBuffers();
-    void loadTextures();
+    void decodeTextures();
+    void uploadTextures();
     void computeStaticTransforms();
     void prepareSkinningData();
     void prepareAnimationData();
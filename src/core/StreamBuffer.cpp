@@ -0,0 +1,130 @@
+#include "StreamBuffer.hpp"
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+// The glad loader is generated for plain GL 3.3, so ARB_buffer_storage is fetched by hand
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (GLAD_API_PTR *BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+StreamBuffer::StreamBuffer()
+    : target(GL_ARRAY_BUFFER)
+    , bufferID(0)
+    , regionSize(0)
+    , region(0)
+    , written(false)
+    , persistentPointer(nullptr)
+{
+    for (int i = 0; i < REGION_COUNT; i++) {
+        fences[i] = 0;
+    }
+}
+
+StreamBuffer::~StreamBuffer() {
+    // GL objects are released in cleanup(), the context may already be gone here
+}
+
+void StreamBuffer::initialize(GLenum target, size_t regionSize) {
+    this->target = target;
+    this->regionSize = regionSize;
+    region = 0;
+    written = false;
+
+    glGenBuffers(1, &bufferID);
+    glBindBuffer(target, bufferID);
+
+    BufferStorageProc bufferStorage = nullptr;
+    if (glfwExtensionSupported("GL_ARB_buffer_storage")) {
+        bufferStorage = reinterpret_cast<BufferStorageProc>(glfwGetProcAddress("glBufferStorage"));
+    }
+
+    if (bufferStorage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        bufferStorage(target, REGION_COUNT * regionSize, nullptr, flags);
+        persistentPointer = glMapBufferRange(target, 0, REGION_COUNT * regionSize, flags);
+        if (!persistentPointer) {
+            std::cerr << "[StreamBuffer] Persistent mapping failed, falling back to per-frame mapping\n";
+        }
+    }
+
+    if (!persistentPointer) {
+        if (bufferStorage) {
+            // Immutable storage can't be respecified with glBufferData
+            glBindBuffer(target, 0);
+            glDeleteBuffers(1, &bufferID);
+            glGenBuffers(1, &bufferID);
+            glBindBuffer(target, bufferID);
+        }
+        glBufferData(target, REGION_COUNT * regionSize, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(target, 0);
+}
+
+void StreamBuffer::waitForRegion(int region) {
+    if (!fences[region]) {
+        return;
+    }
+    GLenum result = glClientWaitSync(fences[region], 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        // The GPU is more than REGION_COUNT - 1 frames behind, block until it catches up
+        result = glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1ms
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cerr << "[StreamBuffer] glClientWaitSync failed\n";
+    }
+    glDeleteSync(fences[region]);
+    fences[region] = 0;
+}
+
+void* StreamBuffer::beginWrite() {
+    if (written) {
+        // Everything that reads the current region has been issued by now
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        region = (region + 1) % REGION_COUNT;
+    }
+    waitForRegion(region);
+    written = true;
+
+    if (persistentPointer) {
+        return static_cast<char*>(persistentPointer) + region * regionSize;
+    }
+    glBindBuffer(target, bufferID);
+    return glMapBufferRange(target, getRegionOffset(), regionSize,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+void StreamBuffer::endWrite() {
+    if (persistentPointer) {
+        // Coherent mapping, the writes are visible to the next draw
+        return;
+    }
+    glBindBuffer(target, bufferID);
+    if (glUnmapBuffer(target) == GL_FALSE) {
+        std::cerr << "[StreamBuffer] Buffer contents were lost while mapped\n";
+    }
+    glBindBuffer(target, 0);
+}
+
+void StreamBuffer::cleanup() {
+    for (int i = 0; i < REGION_COUNT; i++) {
+        if (fences[i]) {
+            glDeleteSync(fences[i]);
+            fences[i] = 0;
+        }
+    }
+    if (bufferID) {
+        if (persistentPointer) {
+            glBindBuffer(target, bufferID);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+            persistentPointer = nullptr;
+        }
+        glDeleteBuffers(1, &bufferID);
+        bufferID = 0;
+    }
+}
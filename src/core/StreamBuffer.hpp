@@ -0,0 +1,61 @@
+#ifndef STREAMBUFFER_HPP
+#define STREAMBUFFER_HPP
+
+#include <glad/gl.h>
+#include <cstddef>
+
+/**
+ * @brief Vertex data that is rewritten every frame, without reallocating the buffer.
+ *
+ * The buffer holds REGION_COUNT regions. Each write goes to the next region, so the CPU fills one
+ * region while the GPU may still be drawing from the previous ones. A fence is placed on a region when
+ * the writer moves past it, and the writer waits on that fence before it comes back around.
+ *
+ * With GL_ARB_buffer_storage the buffer is mapped once (persistent + coherent) and stays mapped.
+ * Otherwise every write maps its region with GL_MAP_UNSYNCHRONIZED_BIT, which is safe because of the fences.
+ */
+class StreamBuffer {
+    public:
+        static const int REGION_COUNT = 3;
+
+        StreamBuffer();
+        ~StreamBuffer();
+
+        StreamBuffer(StreamBuffer const&) = delete;
+        StreamBuffer& operator=(StreamBuffer const&) = delete;
+
+        /**
+         * @brief Create the buffer. Needs a GL context.
+         * @param target binding point used for mapping, e.g. GL_ARRAY_BUFFER
+         * @param regionSize bytes per region
+         */
+        void initialize(GLenum target, size_t regionSize);
+
+        /**
+         * @brief Move to the next region and return a pointer to write it. Only write, never read:
+         * the memory may be write-combined. Call endWrite() before drawing from it.
+         */
+        void* beginWrite();
+        void endWrite();
+
+        // Byte offset of the region written last, for glVertexAttribPointer
+        GLintptr getRegionOffset() const { return static_cast<GLintptr>(region * regionSize); }
+        GLuint getBufferID() const { return bufferID; }
+        size_t getRegionSize() const { return regionSize; }
+        bool isPersistent() const { return persistentPointer != nullptr; }
+
+        void cleanup();
+
+    private:
+        GLenum target;
+        GLuint bufferID;
+        size_t regionSize;
+        int region;
+        bool written;           // The current region holds data the GPU may be reading
+        GLsync fences[REGION_COUNT];
+        void* persistentPointer;
+
+        void waitForRegion(int region);
+};
+
+#endif // STREAMBUFFER_HPP
@@ -5,20 +5,37 @@ Texture::Texture(const char* image, const char* texType, GLuint slot, GLenum for
 	// Assigns the type of the texture ot the texture object
 	type = texType;
 
+	TextureImage decoded;
+	decode(image, decoded);
+	upload(decoded.pixels.get(), decoded.width, decoded.height, decoded.channels, slot);
+}
+
+Texture::Texture(const TextureImage& image, const char* texType, GLuint slot){
+	type = texType;
+	upload(image.pixels.get(), image.width, image.height, image.channels, slot);
+}
+
+bool Texture::decode(const char* image, TextureImage& out) {
+	// glTF stores images with top-left origin; do NOT flip vertically when loading for OpenGL.
+	// (stb's flip flag is global and not thread safe, so it is left at its default of false here)
 	int widthImg, heightImg, numColCh;
-	// glTF stores images with top-left origin; do NOT flip vertically when loading for OpenGL
-	stbi_set_flip_vertically_on_load(false);
 	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
-	bool allocated = false;
 	if (!bytes) {
 		std::cerr << "Failed to load texture: " << image << ". Creating 1x1 white fallback." << std::endl;
-		widthImg = heightImg = 1;
-		numColCh = 4;
-		bytes = (unsigned char*)malloc(4);
-		bytes[0] = 255; bytes[1] = 255; bytes[2] = 255; bytes[3] = 255;
-		allocated = true;
+		static unsigned char white[4] = {255, 255, 255, 255};
+		out.width = out.height = 1;
+		out.channels = 4;
+		out.pixels = std::shared_ptr<unsigned char>(white, [](unsigned char*) {});
+		return false;
 	}
+	out.width = widthImg;
+	out.height = heightImg;
+	out.channels = numColCh;
+	out.pixels = std::shared_ptr<unsigned char>(bytes, stbi_image_free);
+	return true;
+}
 
+void Texture::upload(const unsigned char* bytes, int widthImg, int heightImg, int numColCh, GLuint slot) {
 	glGenTextures(1, &ID);
 	glActiveTexture(GL_TEXTURE0 + slot);
 	unit = slot;
@@ -45,9 +62,6 @@ Texture::Texture(const char* image, const char* texType, GLuint slot, GLenum for
 	// Only generate mipmaps if texture upload succeeded
 	glGenerateMipmap(GL_TEXTURE_2D);
 
-	if (allocated) free(bytes);
-	else stbi_image_free(bytes);
-
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
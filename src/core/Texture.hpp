@@ -1,8 +1,16 @@
-
 #ifndef TEXTURE_HPP
 #define TEXTURE_HPP
 
 #include "Shader.hpp"
+#include <memory>
+
+// Decoded 8 bit image, ready for upload
+struct TextureImage {
+	std::shared_ptr<unsigned char> pixels;  // Freed with stbi_image_free once the last copy is gone
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+};
 
 class Texture{
 	public:
@@ -12,6 +20,13 @@ class Texture{
 
 		Texture(const char* image, const char* texType, GLuint slot, GLenum format, GLenum pixelType);
 
+		// Uploads an image decoded earlier (e.g. on a worker thread) with decode()
+		Texture(const TextureImage& image, const char* texType, GLuint slot);
+
+		// Decodes an image file without touching OpenGL, so it can run on any thread.
+		// Falls back to a 1x1 white image (and returns false) if the file can't be read.
+		static bool decode(const char* image, TextureImage& out);
+
 		// Assigns a texture unit to a texture
 		void setTexUnit(Shader& shader, const char* uniform, GLuint unit);
 
@@ -19,6 +34,9 @@ class Texture{
 		void unbind();
 		void cleanup();
 
+	private:
+		void upload(const unsigned char* bytes, int widthImg, int heightImg, int numColCh, GLuint slot);
+
 };
 
 #endif // TEXTURE_HPP
@@ -0,0 +1,57 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threadCount) : stopping(false) {
+    if (threadCount == 0) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        // Leave one core for the main (GL) thread
+        threadCount = hw > 1 ? hw - 1 : 1;
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+        jobs.clear();
+    }
+    jobsAvailable.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        if (stopping) return;
+        jobs.push_back(std::move(job));
+    }
+    jobsAvailable.notify_one();
+}
+
+void ThreadPool::clearPending() {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    jobs.clear();
+}
+
+size_t ThreadPool::getPendingCount() {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    return jobs.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Small fixed-size pool of worker threads for background jobs.
+ *
+ * Jobs must not touch OpenGL, since the GL context only lives on the main thread.
+ * Anything that needs uploading should be handed back to the main thread and uploaded there.
+ * Jobs still queued when the pool is destroyed are dropped, jobs already running are joined.
+ */
+class ThreadPool {
+    public:
+        /**
+         * @param threadCount number of workers, 0 picks hardware_concurrency() - 1 (at least 1)
+         */
+        explicit ThreadPool(unsigned int threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator=(ThreadPool const&) = delete;
+
+        void enqueue(std::function<void()> job);
+
+        // Drop every job that has not started yet
+        void clearPending();
+
+        size_t getPendingCount();
+        unsigned int getThreadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+    private:
+        void workerLoop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::mutex jobsMutex;
+        std::condition_variable jobsAvailable;
+        bool stopping;
+};
+
+#endif // THREADPOOL_HPP
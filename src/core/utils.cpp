@@ -1,4 +1,5 @@
 #include "utils.hpp"
+#include <algorithm>
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtx/quaternion.hpp>
@@ -8,6 +9,7 @@
 // Anticlockwise version
 std::vector<unsigned int> generate_grid_indices_acw(const unsigned int size) {
     std::vector<unsigned int> r;
+    r.reserve(6 * (size - 1) * (size - 1));
     for (unsigned int i = 0; i <= size - 2; i++) {
         for (unsigned int j = 0; j <= size - 2; j++) {
             r.push_back(i * size + j);
@@ -24,6 +26,7 @@ std::vector<unsigned int> generate_grid_indices_acw(const unsigned int size) {
 // Clockwise version
 std::vector<unsigned int> generate_grid_indices_cw(const unsigned int size) {
     std::vector<unsigned int> r;
+    r.reserve(6 * (size - 1) * (size - 1));
     for (unsigned int i = 0; i <= size - 2; i++) {
         for (unsigned int j = 0; j <= size - 2; j++) {
             r.push_back(i * size + j);
@@ -37,6 +40,96 @@ std::vector<unsigned int> generate_grid_indices_cw(const unsigned int size) {
     return r;
 }
 
+// Same triangles (and diagonals) as generate_grid_indices_acw, as one strip per row of quads.
+// Rows are separated by restartIndex, draw with GL_TRIANGLE_STRIP and primitive restart enabled.
+std::vector<unsigned int> generate_grid_strip_indices(const unsigned int size, const unsigned int restartIndex) {
+    std::vector<unsigned int> r;
+    r.reserve((size - 1) * 2 * size + (size - 2));
+    for (unsigned int i = 0; i <= size - 2; i++) {
+        if (i > 0) {
+            r.push_back(restartIndex);
+        }
+        for (unsigned int j = 0; j < size; j++) {
+            r.push_back(i * size + j);
+            r.push_back(i * size + j + size);
+        }
+    }
+    return r;
+}
+
+std::vector<unsigned int> generate_grid_patch_strip_indices(const unsigned int size, const unsigned int patchQuads,
+                                                            const unsigned int restartIndex, std::vector<unsigned int>& patchStarts) {
+    std::vector<unsigned int> r;
+    patchStarts.clear();
+    const unsigned int quads = size - 1;
+    const unsigned int patches = (quads + patchQuads - 1) / patchQuads;
+    for (unsigned int pz = 0; pz < patches; pz++) {
+        for (unsigned int px = 0; px < patches; px++) {
+            patchStarts.push_back(static_cast<unsigned int>(r.size()));
+            const unsigned int x0 = px * patchQuads;
+            const unsigned int x1 = std::min(x0 + patchQuads, quads);
+            const unsigned int z0 = pz * patchQuads;
+            const unsigned int z1 = std::min(z0 + patchQuads, quads);
+            // Rows of quads in the patch, same winding as generate_grid_strip_indices
+            for (unsigned int i = z0; i < z1; i++) {
+                if (i > z0) {
+                    r.push_back(restartIndex);
+                }
+                for (unsigned int j = x0; j <= x1; j++) {
+                    r.push_back(i * size + j);
+                    r.push_back(i * size + j + size);
+                }
+            }
+        }
+    }
+    patchStarts.push_back(static_cast<unsigned int>(r.size()));
+    return r;
+}
+
+// GLSL has no #include: replace every `#include "file"` line with that file's contents, looked up
+// next to the shader. terrain.vert and shadow_depth.vert pull in terrain_noise.glsl this way.
+static bool resolveShaderIncludes(std::string& code, const char* shader_file_path)
+{
+	std::string directory = shader_file_path;
+	size_t slash = directory.find_last_of("/\\");
+	directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+	std::istringstream lines(code);
+	std::string resolved;
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+		{
+			resolved += line;
+			resolved += '\n';
+			continue;
+		}
+
+		size_t open = line.find('"', start);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos)
+		{
+			printf("Malformed #include in %s: %s\n", shader_file_path, line.c_str());
+			return false;
+		}
+		std::string include_file_path = directory + line.substr(open + 1, close - open - 1);
+		std::ifstream IncludeStream(include_file_path.c_str(), std::ios::in);
+		if (!IncludeStream.is_open())
+		{
+			printf("Shader include not found %s (from %s).\n", include_file_path.c_str(), shader_file_path);
+			return false;
+		}
+		std::stringstream sstr;
+		sstr << IncludeStream.rdbuf();
+		resolved += sstr.str();
+		if (resolved.empty() || resolved[resolved.size() - 1] != '\n') resolved += '\n';
+	}
+	code = resolved;
+	return true;
+}
+
 GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path)
 {
 	// Create the shaders
@@ -75,6 +168,12 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 		return 0;
 	}
 
+	if (!resolveShaderIncludes(VertexShaderCode, vertex_file_path) ||
+		!resolveShaderIncludes(FragmentShaderCode, fragment_file_path))
+	{
+		return 0;
+	}
+
 	GLint Result = GL_FALSE;
 	int InfoLogLength;
 
@@ -201,7 +300,13 @@ GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_fi
 		printf("Geometry shader not found %s.\n", geometry_file_path);
 		return 0;
 	}
-    
+
+    if (!resolveShaderIncludes(VertexShaderCode, vertex_file_path) ||
+        !resolveShaderIncludes(FragmentShaderCode, fragment_file_path) ||
+        !resolveShaderIncludes(GeometryShaderCode, geometry_file_path))
+    {
+        return 0;
+    }
 
     GLint Result = GL_FALSE;
     int InfoLogLength;
@@ -17,6 +17,12 @@
 
 std::vector<unsigned int> generate_grid_indices_acw(const unsigned int size);
 std::vector<unsigned int> generate_grid_indices_cw(const unsigned int size);
+// One strip per row of quads, rows separated by restartIndex: (size - 1) * 2 * size + (size - 2) indices,
+// e.g. 179698 for size 300 where generate_grid_indices_acw needs 6 * (size - 1)^2 = 536406
+std::vector<unsigned int> generate_grid_strip_indices(const unsigned int size, const unsigned int restartIndex);
+// Same strips cut into patchQuads x patchQuads quad patches, each contiguous; patchStarts gets every patch's first index plus the end
+std::vector<unsigned int> generate_grid_patch_strip_indices(const unsigned int size, const unsigned int patchQuads,
+                                                            const unsigned int restartIndex, std::vector<unsigned int>& patchStarts);
 
 GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path);
 GLuint LoadShadersFromFile(const char *vertex_file_path, const char *fragment_file_path, const char *geometry_file_path);
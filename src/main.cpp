@@ -1,6 +1,7 @@
 #include <glm/detail/type_vec.hpp>
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
 #include <memory>
 #include "ArchTree.hpp"
 #include "CheeseMoon.hpp"
@@ -13,6 +14,7 @@
 
 #include "Window.hpp"
 #include "ResourceManager.hpp"
+#include "ModelLoader.hpp"
 #include "Camera.hpp"
 #include "Cube.hpp"
 #include "Perlin.hpp"
@@ -39,62 +41,86 @@ public:
         // Initialize shadow mapping
         shadowMap.initialize();
 
-        // Load shared resources for all model types ONCE before creating instances
-        CheeseMoon::loadSharedResources();
-        ArchTree::loadSharedResources();
-        Phoenix::loadSharedResources();
-        // Note: MushroomLight::loadSharedResources() is called in mushroomSpawner.initialize()
+        // Load shared resources for all model types ONCE before creating instances.
+        // Models are parsed and decoded on worker threads and uploaded from update(),
+        // each entity is set up (and starts drawing) once its model has arrived.
+        glm::vec3 lightPosition = lightingParams.lightPosition;
+        modelLoader.enqueue(&CheeseMoon::sharedResources, false, [this, lightPosition](bool ok) {
+            if (!ok) return;
+            cheeseMoon.initialize(false);
+            cheeseMoon.setPosition(lightPosition);
+            cheeseMoon.setScale(150.0f * glm::vec3(1.0));
+            cheeseMoon.setAlwaysLit(true);
+            cheeseMoonReady = true;
+        });
+        modelLoader.enqueue(&ArchTree::sharedResources, true, [this](bool ok) {
+            if (!ok) return;
+            archTree.initialize(true);
+            archTree.setPosition(glm::vec3(1000, 300, 0));
+            archTreeReady = true;
+        });
+        modelLoader.enqueue(&Phoenix::sharedResources, true, [this](bool ok) {
+            if (!ok) return;
+            phoenix.initialize(true);
+            phoenix.setPosition(glm::vec3(500, 1500, 500));
+            phoenixReady = true;
+        });
+        modelLoader.enqueue(&MushroomLight::sharedResources, false, [this](bool ok) {
+            if (!ok) return;
+            // Initialize mushroom spawner instead of a single mushroom
+            // Spawns mushrooms in low terrain areas (height < -150)
+            mushroomSpawner.initialize(&terrain, -150.0f, 150.0f, 2500.0f, 3000.0f, 0.3f);
+            mushroomsReady = true;
+        });
 
         terrainShader = std::make_shared<Shader>("../shaders/terrain.vert", "../shaders/terrain.frag");
         terrain.initialize(terrainShader, glm::vec3(0,0,0));
+        terrain.initializeDepthShader(shadowMap.depthShader);
         // debugAxes.initialize();
         mybox.initialize(glm::vec3(-200, -1000, 0), glm::vec3(30,30,30));
-        // Light source indicator - bright yellow box
-        cheeseMoon.initialize(false);
-        cheeseMoon.setPosition(lightingParams.lightPosition);
-        cheeseMoon.setScale(150.0f * glm::vec3(1.0));
-        cheeseMoon.setAlwaysLit(true);
-        archTree.initialize(true);
-        archTree.setPosition(glm::vec3(1000, 300, 0));
-        phoenix.initialize(true);
-        phoenix.setPosition(glm::vec3(500, 1500, 500));
-        
-        // Initialize mushroom spawner instead of a single mushroom
-        // Spawns mushrooms in low terrain areas (height < -150)
-        mushroomSpawner.initialize(&terrain, -150.0f, 150.0f, 2500.0f, 3000.0f, 0.3f);
 
         skybox.initialize(glm::vec3(0,0,0), 40000.0f * glm::vec3(1,1,1));
     }
 
+    // Upload models that finished loading in the background, one per frame
+    void updateLoading() { modelLoader.update(1); }
+    bool isLoading() const { return !modelLoader.isFinished(); }
+    int getModelsLoaded() const { return modelLoader.getFinishedCount(); }
+    int getModelsQueued() const { return modelLoader.getQueuedCount(); }
+
     void update(float dt, Camera& camera) {
         terrain.update(dt);
-        archTree.update(dt);
-        phoenix.update(dt);
-        mushroomSpawner.update(camera.getPosition(), dt);
-        cheeseMoon.update(dt, camera.getPosition());
+        if (archTreeReady) archTree.update(dt);
+        if (phoenixReady) phoenix.update(dt);
+        if (mushroomsReady) mushroomSpawner.update(camera.getPosition(), dt);
+        if (cheeseMoonReady) cheeseMoon.update(dt, camera.getPosition());
         skybox.update(camera.getPosition());
     }
 
     void terrUpdateOffset(const glm::vec3& pos) { terrain.updateOffset(pos); }
     float terrGroundConstraint(glm::vec3& pos) { return terrain.groundHeightConstraint(pos); }
     void terrSetNoiseParams(int o, float p, float l) { terrain.setNoiseParams(o,p,l); }
+    void terrSetNoiseSeed(unsigned int seed) { terrain.setNoiseSeed(seed); }
+    void terrSetNoiseBasis(NoiseBasis basis) { terrain.setNoiseBasis(basis); }
     void terrSetPeakHeight(float h) { terrain.setPeakHeight(h); }
     void terrSetWireframeMode(bool enabled) { terrain.setWireframeMode(enabled); }
+    void terrSetMode(TerrainMode mode) { terrain.setMode(mode); }
+    const Terrain& getTerrain() const { return terrain; }
     void updateLightIndicator(const glm::vec3& lightPos) { cheeseMoon.position = lightPos; }
 
     void render(const glm::mat4& vp, const LightingParams& lightingParams, glm::vec3 cameraPos, float farPlane) {
         // debugAxes.render(vp);
         mybox.render(vp);
-        cheeseMoon.render(vp, lightingParams, cameraPos, farPlane);  // Visualize light source position
+        if (cheeseMoonReady) cheeseMoon.render(vp, lightingParams, cameraPos, farPlane);  // Visualize light source position
         
         // Bind shadow cubemap to texture unit 15 (high unit to avoid conflicts with material textures)
         glActiveTexture(GL_TEXTURE15);
         glBindTexture(GL_TEXTURE_CUBE_MAP, shadowMap.depthCubemap);
         
         terrain.render(vp, lightingParams, cameraPos, farPlane);
-        archTree.render(vp, lightingParams, cameraPos, farPlane);
-        phoenix.render(vp, lightingParams, cameraPos, farPlane);
-        mushroomSpawner.render(vp, lightingParams, cameraPos, farPlane);
+        if (archTreeReady) archTree.render(vp, lightingParams, cameraPos, farPlane);
+        if (phoenixReady) phoenix.render(vp, lightingParams, cameraPos, farPlane);
+        if (mushroomsReady) mushroomSpawner.render(vp, lightingParams, cameraPos, farPlane);
 
         skybox.render(vp);
     }
@@ -102,9 +128,9 @@ public:
     void renderDepthPass(const LightingParams& lightingParams) {
         // Render all shadow-casting objects to shadow map
         terrain.renderDepth(shadowMap.depthShader, lightingParams);
-        archTree.renderDepth(shadowMap.depthShader);
-        phoenix.renderDepth(shadowMap.depthShader);
-        mushroomSpawner.renderDepth(shadowMap.depthShader);
+        if (archTreeReady) archTree.renderDepth(shadowMap.depthShader);
+        if (phoenixReady) phoenix.renderDepth(shadowMap.depthShader);
+        if (mushroomsReady) mushroomSpawner.renderDepth(shadowMap.depthShader);
     }
 
 private:
@@ -118,6 +144,13 @@ private:
     MushroomLightSpawner mushroomSpawner;
     SkyBox skybox;
 
+    // Set from the ModelLoader callbacks once each model is usable
+    bool cheeseMoonReady = false;
+    bool archTreeReady = false;
+    bool phoenixReady = false;
+    bool mushroomsReady = false;
+    ModelLoader modelLoader{4}; // One worker per model
+
 public:
     ShadowMap shadowMap;
 };
@@ -176,6 +209,7 @@ public:
         inputManager(mainWindow, camera) {}
 
     bool initialize() {
+        launchTime = std::chrono::steady_clock::now();
         mainWindow.initialize();
         gui.initialize(mainWindow.window);
         scene.initialize(lightingParams);
@@ -194,7 +228,10 @@ public:
         float persistence = 0.503f;
         float lacunarity = 2;
         float peakHeight = 1100.0f;
+        int noiseSeed = 0;
+        int noiseBasis = static_cast<int>(NoiseBasis::Perlin);
         bool terrainWireframe = false;
+        int terrainMode = static_cast<int>(TerrainMode::Chunked);
         // Post-processing state
         bool toonShadingEnabled = false;
         bool lensFlareEnabled = true;
@@ -215,6 +252,12 @@ public:
 
             inputManager.update(dt);
 
+            scene.updateLoading();
+            if (fullyLoadedMs < 0.0 && !scene.isLoading()) {
+                fullyLoadedMs = millisecondsSinceLaunch();
+                std::cout << "[Application] Time to fully loaded: " << fullyLoadedMs << " ms" << std::endl;
+            }
+
             scene.terrUpdateOffset(camera.position);
             camera.setOnGround(scene.terrGroundConstraint(camera.position));
             // only update scene after constrains enforced. Otherwise skybox jitter
@@ -232,6 +275,12 @@ public:
             // [ACKN] ChatGPT generated the boilerplate code for the IMGUI ui controls
             // UI
             gui.newFrame();
+            if (scene.isLoading()) {
+                ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_Always);
+                ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoInputs);
+                ImGui::Text("Loading models... %d / %d", scene.getModelsLoaded(), scene.getModelsQueued());
+                ImGui::End();
+            }
             if (!mainWindow.cursorLocked()) {
                 ImGui::SetNextWindowSize(ImVec2(300, 180), ImGuiCond_FirstUseEver);
                 ImGui::Begin("Terrain Parameters");
@@ -239,13 +288,47 @@ public:
                 ImGui::SliderFloat("Persistence", &persistence, 0.0f, 1.0f);
                 ImGui::SliderFloat("Lacunarity", &lacunarity, 1, 10);
                 ImGui::SliderFloat("Peak Height", &peakHeight, 0.0f, 2000.0f);
+                ImGui::InputInt("Seed (0 = reference)", &noiseSeed);
+                ImGui::Combo("Noise Basis", &noiseBasis, "Perlin\0Simplex\0Value\0");
                 ImGui::Checkbox("Wireframe Mode", &terrainWireframe);
+                ImGui::Combo("Terrain Mode", &terrainMode, "Grid (CPU, scrolled)\0Chunked (streamed)\0Clipmap (LOD rings)\0Grid (GPU noise)\0Grid (height map texture)\0");
+                if (terrainMode == static_cast<int>(TerrainMode::Chunked)) {
+                    const TerrainChunkManager& chunks = scene.getTerrain().getChunkManager();
+                    ImGui::Text("Chunks loaded: %d, pending: %d, load radius: %d",
+                                (int)chunks.getLoadedChunkCount(), (int)chunks.getPendingChunkCount(), chunks.getLoadRadius());
+                    ImGui::Text("Chunks drawn (frustum culled): %d", chunks.getLastChunksDrawn());
+                    ImGui::Text("Baked tiles: %s, chunks from tiles: %u, from noise: %u",
+                                chunks.isUsingTileFile() ? "on" : "off",
+                                chunks.getBakedChunkCount(), chunks.getGeneratedChunkCount());
+                } else if (terrainMode == static_cast<int>(TerrainMode::Clipmap)) {
+                    const TerrainClipmap& clipmap = scene.getTerrain().getClipmap();
+                    ImGui::Text("Levels: %d, vertices: %d, coverage: %.0f",
+                                clipmap.getLevelCount(), (int)clipmap.getVertexCount(), clipmap.getCoverage());
+                } else if (terrainMode == static_cast<int>(TerrainMode::Grid) ||
+                           terrainMode == static_cast<int>(TerrainMode::Heightmap)) {
+                    const Terrain& terrain = scene.getTerrain();
+                    ImGui::Text("Noise samples last frame: %d, upload: %d bytes",
+                                terrain.getLastSamplesComputed(), (int)terrain.getLastUploadBytes());
+                    ImGui::Text("Regenerations performed: %lu, skipped: %lu",
+                                terrain.getRegenerationsPerformed(), terrain.getRegenerationsSkipped());
+                }
+                if (terrainMode == static_cast<int>(TerrainMode::Grid) ||
+                    terrainMode == static_cast<int>(TerrainMode::Heightmap) ||
+                    terrainMode == static_cast<int>(TerrainMode::GPUNoise)) {
+                    const Terrain& terrain = scene.getTerrain();
+                    ImGui::Text("Patches drawn: %d / %d, shadow patch draws: %d",
+                                terrain.getLastPatchesDrawn(), terrain.getPatchCount(), terrain.getLastShadowPatchDraws());
+                }
+                ImGui::Text("Query cache: %d entries, hits: %lu, misses: %lu",
+                            (int)scene.getTerrain().getQueryCacheSize(),
+                            scene.getTerrain().getQueryCacheHits(), scene.getTerrain().getQueryCacheMisses());
                 ImGui::End();
 
                 ImGui::SetNextWindowSize(ImVec2(300, 80), ImGuiCond_FirstUseEver);
                 ImGui::Begin("View Parameters");
                 ImGui::SliderFloat("View Distance", &viewDist, 500.0f, 100000.0f);
                 ImGui::Checkbox("Pause Physics", &pausePhysics);
+                ImGui::Text("Startup: first frame %.0f ms, fully loaded %.0f ms", firstFrameMs, fullyLoadedMs);
                 ImGui::End();
 
                 ImGui::SetNextWindowSize(ImVec2(320, 340), ImGuiCond_FirstUseEver);
@@ -324,12 +407,19 @@ public:
 
                 scene.terrSetNoiseParams(octaves, persistence, lacunarity);
                 scene.terrSetPeakHeight(peakHeight);
+                scene.terrSetNoiseSeed(static_cast<unsigned int>(noiseSeed));
+                scene.terrSetNoiseBasis(static_cast<NoiseBasis>(noiseBasis));
                 scene.terrSetWireframeMode(terrainWireframe);
+                scene.terrSetMode(static_cast<TerrainMode>(terrainMode));
                 scene.updateLightIndicator(lightingParams.lightPosition);
             }
             gui.render();
 
             mainWindow.swapBuffers();
+            if (firstFrameMs < 0.0) {
+                firstFrameMs = millisecondsSinceLaunch();
+                std::cout << "[Application] Time to first frame: " << firstFrameMs << " ms" << std::endl;
+            }
         }
 
         gui.shutdown();
@@ -338,6 +428,15 @@ public:
     }
 
 private:
+    double millisecondsSinceLaunch() const {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+    }
+
+    // Startup timings, measured from initialize(); negative until reached
+    std::chrono::steady_clock::time_point launchTime;
+    double firstFrameMs = -1.0;
+    double fullyLoadedMs = -1.0;
+
     Window mainWindow;
     Timer timer;
     Camera camera;
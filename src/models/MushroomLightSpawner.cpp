@@ -32,6 +32,8 @@ void MushroomLightSpawner::initialize(Terrain* terrain,
     mushroomWorldXZ.clear();
     cellToMushroomIndex.clear();
     evaluatedCells.clear();
+    queuedXZ.clear();
+    queuedKeys.clear();
     
     // Load shared resources (model, shader, textures) ONCE for all instances
     MushroomLight::loadSharedResources();
@@ -91,30 +93,49 @@ bool MushroomLightSpawner::tryActivateCell(int cellX, int cellZ) {
     float worldX = (cellX + jitterX) * cellSize;
     float worldZ = (cellZ + jitterZ) * cellSize;
     
-    // Query terrain height at this position
-    float height = terrain->getHeightAt(worldX, worldZ);
-    
+    // The terrain is queried for all queued cells at once in spawnQueuedCells()
+    queuedXZ.push_back(glm::vec2(worldX, worldZ));
+    queuedKeys.push_back(key);
+    return false;
+}
+
+void MushroomLightSpawner::spawnQueuedCells() {
+    // Query terrain height at every candidate in one batch
+    queuedHeights.resize(queuedXZ.size());
+    terrain->getHeightsAt(queuedXZ.data(), queuedHeights.data(), queuedXZ.size());
+
     // Only spawn if below threshold (in valleys/low areas)
-    if (height >= spawnHeightThreshold) {
-        return false;
+    size_t accepted = 0;
+    for (size_t i = 0; i < queuedXZ.size(); i++) {
+        if (queuedHeights[i] < spawnHeightThreshold) {
+            queuedXZ[accepted] = queuedXZ[i];
+            queuedKeys[accepted] = queuedKeys[i];
+            queuedHeights[accepted] = queuedHeights[i];
+            accepted++;
+        }
     }
-    
-    // Get terrain normal for orientation
-    glm::vec3 normal = terrain->getNormalAt(worldX, worldZ);
-    glm::vec3 position(worldX, height, worldZ);
-    
-    // Create new mushroom instance (lightweight - uses shared resources)
-    auto mushroom = std::make_shared<MushroomLight>();
-    mushroom->initializeInstance(false);  // false = not skinned
-    configureMushroom(mushroom, position, normal);
-    
-    // Add to pool
-    size_t index = allMushrooms.size();
-    allMushrooms.push_back(mushroom);
-    mushroomWorldXZ.push_back(glm::vec2(worldX, worldZ));  // Store X/Z for height updates
-    cellToMushroomIndex[key] = index;
-    
-    return true;
+
+    // Normals (for orientation) only where a mushroom actually spawns
+    queuedNormals.resize(accepted);
+    terrain->getNormalsAt(queuedXZ.data(), queuedNormals.data(), accepted);
+
+    for (size_t i = 0; i < accepted; i++) {
+        glm::vec3 position(queuedXZ[i].x, queuedHeights[i], queuedXZ[i].y);
+
+        // Create new mushroom instance (lightweight - uses shared resources)
+        auto mushroom = std::make_shared<MushroomLight>();
+        mushroom->initializeInstance(false);  // false = not skinned
+        configureMushroom(mushroom, position, queuedNormals[i]);
+
+        // Add to pool
+        size_t index = allMushrooms.size();
+        allMushrooms.push_back(mushroom);
+        mushroomWorldXZ.push_back(queuedXZ[i]);  // Store X/Z for height updates
+        cellToMushroomIndex[queuedKeys[i]] = index;
+    }
+
+    queuedXZ.clear();
+    queuedKeys.clear();
 }
 
 void MushroomLightSpawner::configureMushroom(std::shared_ptr<MushroomLight> mushroom, 
@@ -162,8 +183,9 @@ void MushroomLightSpawner::update(const glm::vec3& cameraPos, float deltaTime) {
             // Update Y position based on current terrain height
             float worldX = mushroomWorldXZ[i].x;
             float worldZ = mushroomWorldXZ[i].y;
-            float newHeight = terrain->getHeightAt(worldX, worldZ);
-            glm::vec3 normal = terrain->getNormalAt(worldX, worldZ);
+            float newHeight;
+            glm::vec3 normal;
+            terrain->getHeightAndNormalAt(worldX, worldZ, newHeight, normal);
             
             // Reconfigure mushroom position and orientation
             glm::vec3 newPos(worldX, newHeight, worldZ);
@@ -200,6 +222,9 @@ void MushroomLightSpawner::update(const glm::vec3& cameraPos, float deltaTime) {
             }
         }
     }
+    if (!queuedXZ.empty()) {
+        spawnQueuedCells();
+    }
 }
 
 size_t MushroomLightSpawner::getActiveMushroomCount() const {
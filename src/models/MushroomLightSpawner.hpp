@@ -84,6 +84,12 @@ private:
     // Set of cell keys that have been evaluated (spawned or determined not to spawn)
     std::unordered_set<int64_t> evaluatedCells;
 
+    // Cells that passed the spawn roll this update, waiting for one batched terrain query
+    std::vector<glm::vec2> queuedXZ;
+    std::vector<int64_t> queuedKeys;
+    std::vector<float> queuedHeights;
+    std::vector<glm::vec3> queuedNormals;
+
     /**
      * @brief Generate a unique key for a cell from its coordinates
      */
@@ -100,11 +106,16 @@ private:
     float cellRandom(int cellX, int cellZ, int salt = 0) const;
 
     /**
-     * @brief Try to spawn or reactivate a mushroom in the given cell
-     * @return true if mushroom is now active in that cell
+     * @brief Reactivate the mushroom in the given cell, or queue a new cell for spawnQueuedCells()
+     * @return true if mushroom is now active in that cell (queued cells are not yet)
      */
     bool tryActivateCell(int cellX, int cellZ);
 
+    /**
+     * @brief Spawn mushrooms in the queued cells that are below the height threshold, one batched terrain query
+     */
+    void spawnQueuedCells();
+
     /**
      * @brief Configure a mushroom instance at the given position with terrain alignment
      */
@@ -0,0 +1,68 @@
+// Converts glTF models into cooked files (see CookedModel) next to them, which the game loads
+// instead of parsing the glTF JSON. Re-run after editing a model: a cooked file older than its
+// glTF is ignored at runtime.
+//
+// Usage: model_cooker [scene.gltf ...]
+//        (default: every model the game loads, paths relative to the build directory)
+
+#include "CookedModel.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) paths.push_back(argv[i]);
+    if (paths.empty()) {
+        paths.push_back("../assets/arch_tree/scene.gltf");
+        paths.push_back("../assets/cheese_moon/scene.gltf");
+        paths.push_back("../assets/phoenix_bird/scene.gltf");
+        paths.push_back("../assets/MushroomLight/scene.gltf");
+    }
+
+    int failures = 0;
+    for (const std::string& gltfPath : paths) {
+        tinygltf::TinyGLTF loader;
+        tinygltf::Model model;
+        std::string err, warn;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool ok = loader.LoadASCIIFromFile(&model, &err, &warn, gltfPath);
+        double gltfMs = millisecondsSince(start);
+        if (!warn.empty()) std::printf("WARN: %s\n", warn.c_str());
+        if (!ok) {
+            std::fprintf(stderr, "Failed to load %s: %s\n", gltfPath.c_str(), err.c_str());
+            failures++;
+            continue;
+        }
+
+        const std::string cookedPath = CookedModel::pathFor(gltfPath);
+        if (!CookedModel::write(model, cookedPath, err)) {
+            std::fprintf(stderr, "Failed to cook %s: %s\n", gltfPath.c_str(), err.c_str());
+            failures++;
+            continue;
+        }
+
+        // Read it straight back, both to check it and to show what the runtime saves
+        tinygltf::Model cooked;
+        start = std::chrono::steady_clock::now();
+        if (!CookedModel::read(cookedPath, cooked, err)) {
+            std::fprintf(stderr, "Failed to read back %s: %s\n", cookedPath.c_str(), err.c_str());
+            failures++;
+            continue;
+        }
+        double cookedMs = millisecondsSince(start);
+        std::printf("%s -> %s (glTF load %.1f ms, cooked load %.1f ms)\n",
+                    gltfPath.c_str(), cookedPath.c_str(), gltfMs, cookedMs);
+    }
+    return failures == 0 ? 0 : 1;
+}
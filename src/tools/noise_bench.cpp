@@ -0,0 +1,101 @@
+// Compares the ways PerlinNoise can fill a terrain-style grid (single thread):
+// - per point:     octavePerlin for every sample, like the original Terrain::update
+// - batch:         octavePerlinBatch (SIMD) over the same coordinates
+// - row coherent:  octavePerlinGrid, one pass per row and octave
+// then the same grid through each NoiseBasis, to pick the cheapest one that looks good enough.
+//
+// Usage: noise_bench [resolution...]   (default 300 1024 4096)
+
+#include "Perlin.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void benchmark(const PerlinNoise& pn, int resolution) {
+    // Terrain defaults: 5 octaves, grid spanning specialScale * scale = 2.5 * 3000 world units
+    const int octaves = 5;
+    const float persistence = 0.503f;
+    const float lacunarity = 2.0f;
+    const float horizontalScale = 3000.0f;
+    const float extent = 2.5f * horizontalScale;
+    const float step = extent / resolution;
+    const float x0 = 1234.5f;
+    const float z0 = -6789.25f;
+    const size_t count = static_cast<size_t>(resolution) * resolution;
+
+    std::vector<float> perPoint(count), batch(count), grid(count);
+    std::vector<float> xs(count), zs(count);
+    for (int r = 0; r < resolution; r++) {
+        for (int c = 0; c < resolution; c++) {
+            xs[c + r * resolution] = x0 + c * step;
+            zs[c + r * resolution] = z0 + r * step;
+        }
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; i++) {
+        perPoint[i] = pn.octavePerlin(xs[i] / horizontalScale, zs[i] / horizontalScale, octaves, persistence, lacunarity);
+    }
+    double perPointMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    pn.octavePerlinBatch(&xs[0], &zs[0], &batch[0], static_cast<int>(count), octaves, persistence, lacunarity,
+                         1.0f / horizontalScale);
+    double batchMs = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    pn.octavePerlinGrid(x0, z0, step, resolution, resolution, &grid[0], octaves, persistence, lacunarity,
+                        1.0f / horizontalScale);
+    double gridMs = millisecondsSince(start);
+
+    float batchError = 0.0f, gridError = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        batchError = std::fmax(batchError, std::fabs(batch[i] - perPoint[i]));
+        gridError = std::fmax(gridError, std::fabs(grid[i] - perPoint[i]));
+    }
+
+    std::printf("%5d x %-5d  per point %9.2f ms   batch %9.2f ms (x%.1f, err %.1e)   row coherent %9.2f ms (x%.1f, err %.1e)\n",
+                resolution, resolution, perPointMs,
+                batchMs, perPointMs / batchMs, batchError,
+                gridMs, perPointMs / gridMs, gridError);
+}
+
+static void benchmarkBases(int resolution) {
+    const char* names[] = { "Perlin", "Simplex", "Value" };
+    const size_t count = static_cast<size_t>(resolution) * resolution;
+    std::vector<float> grid(count);
+    std::printf("%5d x %-5d ", resolution, resolution);
+    for (int basis = 0; basis < 3; basis++) {
+        PerlinNoise pn(-1, 0, static_cast<NoiseBasis>(basis));
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        pn.octavePerlinGrid(1234.5f, -6789.25f, 7500.0f / resolution, resolution, resolution, &grid[0],
+                            5, 0.503f, 2.0f, 1.0f / 3000.0f);
+        std::printf(" %s %9.2f ms ", names[basis], millisecondsSince(start));
+    }
+    std::printf("\n");
+}
+
+int main(int argc, char** argv) {
+    PerlinNoise pn(-1);
+    std::vector<int> resolutions;
+    for (int i = 1; i < argc; i++) {
+        resolutions.push_back(std::atoi(argv[i]));
+    }
+    if (resolutions.empty()) {
+        resolutions = { 300, 1024, 4096 };
+    }
+    for (int resolution : resolutions) {
+        benchmark(pn, resolution);
+    }
+    std::printf("Noise bases (octavePerlinGrid):\n");
+    for (int resolution : resolutions) {
+        benchmarkBases(resolution);
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+// Bakes the terrain around the origin into a tile file that Terrain maps at startup (Chunked mode),
+// so chunks inside the baked area are read from disk instead of sampled from noise.
+// Uses the terrain defaults (TerrainNoiseParams, 1000 unit chunks of 41 vertices), changing the
+// parameters at runtime makes Terrain ignore the file until they match again.
+//
+// Usage: terrain_bake [output] [radius in tiles] [seed] [basis 0=Perlin 1=Simplex 2=Value]
+//        (default ../terrain_tiles.bin 16 0 0)
+
+#include "Perlin.hpp"
+#include "TerrainParams.hpp"
+#include "TerrainTiles.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "../terrain_tiles.bin";
+    const int radius = argc > 2 ? std::atoi(argv[2]) : 16;
+    const unsigned int seed = argc > 3 ? static_cast<unsigned int>(std::strtoul(argv[3], nullptr, 10)) : 0;
+    const int basis = argc > 4 ? std::atoi(argv[4]) : 0;
+    if (radius < 0 || basis < 0 || basis > 2) {
+        std::fprintf(stderr, "Usage: terrain_bake [output] [radius in tiles] [seed] [basis 0..2]\n");
+        return 1;
+    }
+
+    // Must match TerrainChunkManager::initialize() defaults, or the file is never used
+    const float tileSize = 1000.0f;
+    const int tileResolution = 41;
+
+    TerrainNoiseParams params;
+    params.seed = seed;
+    params.basis = static_cast<NoiseBasis>(basis);
+    PerlinNoise pn(-1, params.seed, params.basis);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool ok = TerrainTileFile::bake(path, pn, params, tileSize, tileResolution,
+                                    glm::ivec2(-radius, -radius), glm::ivec2(radius, radius));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!ok) return 1;
+    std::printf("Baked %d x %d tiles in %.1f ms\n", 2 * radius + 1, 2 * radius + 1, ms);
+    return 0;
+}